@@ -0,0 +1,96 @@
+// fms_acf.h - auto covariance and correlation
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+namespace fms {
+
+	inline const char acf_doc[] = R"xyzyx(
+The <em>auto covariance</em> at lag <code>i</code> is the covariance of
+<code>x[0], ..., x[n - i - 1]</code> and <code>x[i], ..., x[n - 1]</code>.
+The means of the leading and trailing items are updated from the previous lag.
+)xyzyx";
+
+	namespace acf_ {
+
+		// covariance of x and y with means x_ and y_
+		inline double cov(size_t n, const double* x, const double* y, double x_, double y_)
+		{
+			double c = 0;
+
+			for (size_t i = 0; i < n; ++i) {
+				c += (x[i] - x_) * (y[i] - y_);
+			}
+
+			return c / n;
+		}
+	}
+
+	// Auto covariance y[i] of the n items x at lag i, or auto correlation if corr.
+	// Stop before the next lag once *cancel is set.
+	inline void acf(size_t n, const double* x, double* y, bool corr = false, const std::atomic<bool>* cancel = nullptr)
+	{
+		if (n == 0) {
+			return;
+		}
+
+		// (x[0] + ... x[n - i - 1])/(n - i)
+		double xi_ = std::accumulate(x, x + n, 0.) / n;
+		// (x[i] + ... + x[n-1])/(n - i)
+		double _xi = xi_;
+
+		y[0] = acf_::cov(n, x, x, xi_, _xi);
+
+		// cov(x, x + i)
+		for (size_t i = 1; i < n; ++i) {
+			if (cancel && cancel->load(std::memory_order_relaxed)) {
+				return;
+			}
+			xi_ *= n - i + 1;
+			xi_ -= x[n - i];
+			xi_ /= (n - i);
+
+			_xi *= n - i + 1;
+			_xi -= x[i - 1];
+			_xi /= (n - i);
+
+			y[i] = acf_::cov(n - i, x, x + i, xi_, _xi);
+			if (corr) {
+				y[i] /= y[0];
+			}
+		}
+		if (corr) {
+			y[0] = 1;
+		}
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int acf_test()
+	{
+		{
+			double x[] = { 1, 2, 3 };
+			double y[3];
+			acf(3, x, y);
+			assert(std::fabs(y[0] - 2. / 3) < 1e-15);
+			assert(std::fabs(y[1] - 0.25) < 1e-15);
+			assert(std::fabs(y[2]) < 1e-15);
+
+			acf(3, x, y, true);
+			assert(y[0] == 1);
+			assert(std::fabs(y[1] - 0.375) < 1e-15);
+
+			std::atomic<bool> cancel = true;
+			y[1] = 0;
+			acf(3, x, y, false, &cancel);
+			assert(y[1] == 0);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_acf.t.cpp - auto covariance tests
+#include "fms_acf.h"
+
+#ifdef _DEBUG
+int fms_acf_test = fms::acf_test();
+#endif // _DEBUG
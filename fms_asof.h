@@ -0,0 +1,134 @@
+// fms_asof.h - as-of join of sorted times
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char asof_doc[] = R"xyzyx(
+An <em>as-of join</em> matches each left time with a right time that is not
+later (backward), not earlier (forward), or closest (nearest). Both times must
+be increasing so one linear merge finds every match. Blocks of left times
+find their starting right time by binary search and are joined in parallel.
+)xyzyx";
+
+	// number of left times joined by one task
+	inline size_t asof_block = 1 << 14;
+
+	enum class asof_direction {
+		backward, // last right time not after the left time
+		forward,  // first right time not before the left time
+		nearest,  // closest right time, backward on ties
+	};
+
+	namespace asof_ {
+
+		// Join left times [b, e) writing matched right indices or NaN to j.
+		inline void block(size_t b, size_t e, const double* t, size_t m, const double* s, double* j, asof_direction dir, double tol)
+		{
+			// s[0, lo) < t[i] and s[0, hi) <= t[i]
+			size_t lo = std::lower_bound(s, s + m, t[b]) - s;
+			size_t hi = std::upper_bound(s + lo, s + m, t[b]) - s;
+
+			for (size_t i = b; i < e; ++i) {
+				const double ti = t[i];
+				while (lo < m && s[lo] < ti) {
+					++lo;
+				}
+				if (hi < lo) {
+					hi = lo;
+				}
+				while (hi < m && s[hi] <= ti) {
+					++hi;
+				}
+
+				size_t k = m; // no match
+				if (dir == asof_direction::backward) {
+					k = hi > 0 ? hi - 1 : m;
+				}
+				else if (dir == asof_direction::forward) {
+					k = lo;
+				}
+				else {
+					size_t kb = hi > 0 ? hi - 1 : m;
+					size_t kf = lo;
+					if (kb == m) {
+						k = kf;
+					}
+					else if (kf == m) {
+						k = kb;
+					}
+					else {
+						k = s[kf] - ti < ti - s[kb] ? kf : kb;
+					}
+				}
+
+				j[i] = (k < m && !(std::fabs(s[k] - ti) > tol)) ? static_cast<double>(k) : NAN;
+			}
+		}
+	}
+
+	// For increasing left times t and right times s set j[i] to the index of the
+	// right time matching t[i] in direction dir within tolerance tol, or NaN.
+	inline void asof(size_t n, const double* t, size_t m, const double* s, double* j,
+		asof_direction dir = asof_direction::backward, double tol = INFINITY)
+	{
+		const size_t b = asof_block;
+
+		parallel_for((n + b - 1) / b, [=](size_t k) {
+			asof_::block(k * b, std::min(n, (k + 1) * b), t, m, s, j, dir, tol);
+		});
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int asof_test()
+	{
+		{
+			double t[] = { 0, 1, 2.4, 2.6, 5, 9 };
+			double s[] = { 1, 2, 2, 3, 8 };
+			double j[6];
+
+			asof(6, t, 5, s, j);
+			assert(std::isnan(j[0]) && j[1] == 0 && j[2] == 2 && j[3] == 2 && j[4] == 3 && j[5] == 4);
+
+			asof(6, t, 5, s, j, asof_direction::forward);
+			assert(j[0] == 0 && j[1] == 0 && j[2] == 3 && j[3] == 3 && j[4] == 4 && std::isnan(j[5]));
+
+			asof(6, t, 5, s, j, asof_direction::nearest);
+			assert(j[0] == 0 && j[1] == 0 && j[2] == 2 && j[3] == 3 && j[4] == 3 && j[5] == 4);
+
+			asof(6, t, 5, s, j, asof_direction::backward, 0.5);
+			assert(std::isnan(j[0]) && j[1] == 0 && j[2] == 2 && std::isnan(j[3]) && std::isnan(j[4]) && std::isnan(j[5]));
+		}
+		{
+			// blocks agree with one linear pass
+			size_t block = asof_block;
+			size_t n = 1000, m = 300;
+			std::vector<double> t(n), s(m), j(n), k(n);
+			for (size_t i = 0; i < n; ++i) {
+				t[i] = i * 0.37;
+			}
+			for (size_t i = 0; i < m; ++i) {
+				s[i] = double(i + (i % 3 == 0));
+			}
+			for (auto dir : { asof_direction::backward, asof_direction::forward, asof_direction::nearest }) {
+				asof_block = n;
+				asof(n, t.data(), m, s.data(), j.data(), dir, 2.);
+				asof_block = 7;
+				asof(n, t.data(), m, s.data(), k.data(), dir, 2.);
+				for (size_t i = 0; i < n; ++i) {
+					assert(j[i] == k[i] || (std::isnan(j[i]) && std::isnan(k[i])));
+				}
+			}
+			asof_block = block;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_asof.t.cpp - as-of join tests
+#include "fms_asof.h"
+
+#ifdef _DEBUG
+int fms_asof_test = fms::asof_test();
+#endif // _DEBUG
@@ -0,0 +1,345 @@
+// fms_async.h - background jobs with completion and cancellation
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace fms {
+
+	inline const char async_doc[] = R"xyzyx(
+An <em>asynchronous result</em> is returned immediately and becomes ready
+when a job on the background thread completes. Jobs run one at a time in the
+order they were started and use the shared scheduler for their parallel work.
+A job can be cancelled before it starts or poll for cancellation while running.
+)xyzyx";
+
+	enum class async_status {
+		pending,   // queued
+		running,
+		ready,
+		cancelled,
+		failed     // the job threw an exception
+	};
+
+	template<class T>
+	class async_result {
+		mutable std::mutex m;
+		mutable std::condition_variable cv;
+		async_status status_ = async_status::pending;
+		T value_;
+		std::exception_ptr ex_;
+		std::atomic<bool> cancel_ = false;
+
+		void finish(async_status s)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m);
+				status_ = s;
+			}
+			cv.notify_all();
+		}
+	public:
+		async_status status() const
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			return status_;
+		}
+		// the job is no longer pending or running
+		bool done() const
+		{
+			auto s = status();
+
+			return s != async_status::pending && s != async_status::running;
+		}
+		// wait at most timeout for the job and return done()
+		bool wait(std::chrono::milliseconds timeout) const
+		{
+			std::unique_lock<std::mutex> lock(m);
+
+			return cv.wait_for(lock, timeout, [this] {
+				return status_ != async_status::pending && status_ != async_status::running;
+			});
+		}
+		void wait() const
+		{
+			std::unique_lock<std::mutex> lock(m);
+			cv.wait(lock, [this] {
+				return status_ != async_status::pending && status_ != async_status::running;
+			});
+		}
+		// wait for the value and rethrow the exception of a failed job
+		T& get()
+		{
+			wait();
+			if (status_ == async_status::cancelled) {
+				throw std::runtime_error("async_result: cancelled");
+			}
+			if (ex_) {
+				std::rethrow_exception(ex_);
+			}
+
+			return value_;
+		}
+
+		// request cancellation, pending jobs do not run
+		void cancel()
+		{
+			cancel_ = true;
+		}
+		// polled by jobs
+		bool cancelled() const
+		{
+			return cancel_;
+		}
+		// flag for kernels that stop between chunks
+		const std::atomic<bool>* cancellation() const
+		{
+			return &cancel_;
+		}
+
+		// run f(*this) unless cancelled and store its value
+		template<class F>
+		void run(F& f)
+		{
+			if (cancelled()) {
+				finish(async_status::cancelled);
+
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(m);
+				status_ = async_status::running;
+			}
+			try {
+				value_ = f(static_cast<const async_result&>(*this));
+				finish(cancelled() ? async_status::cancelled : async_status::ready);
+			}
+			catch (...) {
+				ex_ = std::current_exception();
+				finish(async_status::failed);
+			}
+		}
+	};
+
+	// single background thread running jobs in order
+	class background {
+		std::mutex life; // post and shutdown
+		std::mutex m;
+		std::condition_variable cv;
+		std::deque<std::function<void(bool)>> q; // called with true if the job is cancelled
+		bool stop = false;
+		std::atomic<size_t> posted_ = 0, completed_ = 0;
+		std::thread t;
+
+		void loop()
+		{
+			for (;;) {
+				std::function<void(bool)> f;
+				{
+					std::unique_lock<std::mutex> lock(m);
+					cv.wait(lock, [this] { return stop || !q.empty(); });
+					if (q.empty()) {
+						return;
+					}
+					f = std::move(q.front());
+					q.pop_front();
+				}
+				f(false);
+				++completed_;
+			}
+		}
+	public:
+		background()
+			: t(&background::loop, this)
+		{ }
+		background(const background&) = delete;
+		background& operator=(const background&) = delete;
+		// finishes queued jobs
+		~background()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m);
+				stop = true;
+			}
+			cv.notify_all();
+			if (t.joinable()) {
+				t.join();
+			}
+		}
+
+		// never destroyed so jobs outlive static objects
+		static background& instance()
+		{
+			static background* b = new background();
+
+			return *b;
+		}
+
+		// Cancel queued jobs and join the thread after the running job.
+		// The next post starts the thread again.
+		void shutdown()
+		{
+			std::lock_guard<std::mutex> lock_(life);
+			std::deque<std::function<void(bool)>> dropped;
+			{
+				std::lock_guard<std::mutex> lock(m);
+				stop = true;
+				dropped.swap(q);
+			}
+			cv.notify_all();
+			for (auto& f : dropped) {
+				f(true);
+				++completed_;
+			}
+			if (t.joinable()) {
+				t.join();
+			}
+		}
+
+		// number of jobs finished or cancelled so far
+		size_t completed() const
+		{
+			return completed_;
+		}
+		// number of jobs queued or running
+		size_t outstanding() const
+		{
+			return posted_ - completed_;
+		}
+
+		// Queue f(cancel) to run after the jobs already posted.
+		void post(std::function<void(bool)> f)
+		{
+			std::lock_guard<std::mutex> lock_(life);
+			{
+				std::lock_guard<std::mutex> lock(m);
+				if (stop && !t.joinable()) {
+					stop = false;
+					t = std::thread(&background::loop, this);
+				}
+				++posted_;
+				q.push_back(std::move(f));
+			}
+			cv.notify_one();
+		}
+	};
+
+	// Start f(const async_result<T>&) returning T on the background thread.
+	template<class T, class F>
+	inline std::shared_ptr<async_result<T>> async(F f, background& b = background::instance())
+	{
+		auto r = std::make_shared<async_result<T>>();
+
+		b.post([r, f = std::move(f)](bool cancel) mutable {
+			if (cancel) {
+				r->cancel();
+			}
+			r->run(f);
+		});
+
+		return r;
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int async_test()
+	{
+		background b;
+		{
+			auto r = async<int>([](const auto&) { return 42; }, b);
+			assert(r->get() == 42);
+			assert(r->status() == async_status::ready);
+		}
+		{
+			// jobs run in order so the second is pending while the first runs
+			std::atomic<bool> go = false;
+			auto r = async<int>([&go](const auto&) {
+				while (!go) {
+					std::this_thread::yield();
+				}
+				return 1;
+			}, b);
+			auto s = async<int>([](const auto&) { return 2; }, b);
+			assert(!s->wait(std::chrono::milliseconds(10)));
+			s->cancel();
+			go = true;
+			assert(r->get() == 1);
+			s->wait();
+			assert(s->status() == async_status::cancelled);
+		}
+		{
+			// running jobs poll for cancellation
+			auto r = async<int>([](const auto& token) {
+				while (!token.cancelled()) {
+					std::this_thread::yield();
+				}
+				return 0;
+			}, b);
+			r->cancel();
+			r->wait();
+			assert(r->status() == async_status::cancelled);
+		}
+		{
+			auto r = async<int>([](const auto&) -> int { throw std::runtime_error("async_test"); }, b);
+			r->wait();
+			assert(r->status() == async_status::failed);
+			bool thrown = false;
+			try {
+				r->get();
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+		{
+			background c;
+			auto r = async<int>([](const auto&) { return 1; }, c);
+			r->wait();
+			while (c.completed() != 1) {
+				std::this_thread::yield();
+			}
+			c.shutdown();
+			c.shutdown();
+			assert(c.outstanding() == 0);
+		}
+		{
+			// shutdown cancels queued jobs and post starts the thread again
+			background c;
+			std::atomic<bool> go = false;
+			auto r = async<int>([&go](const auto&) {
+				while (!go) {
+					std::this_thread::yield();
+				}
+				return 1;
+			}, c);
+			while (r->status() != async_status::running) {
+				std::this_thread::yield();
+			}
+			auto s = async<int>([](const auto&) { return 2; }, c);
+			std::thread t([&c] { c.shutdown(); });
+			s->wait();
+			assert(s->status() == async_status::cancelled);
+			go = true;
+			t.join();
+			assert(r->get() == 1);
+			assert(c.outstanding() == 0);
+
+			auto u = async<int>([](const auto&) { return 3; }, c);
+			assert(u->get() == 3);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
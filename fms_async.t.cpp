@@ -0,0 +1,6 @@
+// fms_async.t.cpp - background job tests
+#include "fms_async.h"
+
+#ifdef _DEBUG
+int fms_async_test = fms::async_test();
+#endif // _DEBUG
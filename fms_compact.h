@@ -0,0 +1,309 @@
+// fms_compact.h - stream compaction
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char compact_doc[] = R"xyzyx(
+<em>Compaction</em> keeps the items of an array having a non-zero mask value
+and moves them to the front of the array in their original order.
+Masks shorter than the array are applied cyclically.
+)xyzyx";
+
+	// number of doubles compacted by one task
+	inline size_t compact_block = 1 << 16;
+
+	namespace compact_ {
+
+		inline bool keep(double m)
+		{
+			return m != 0; // NaN is kept
+		}
+
+		// Few items kept: skip over zeros with a well predicted branch.
+		inline size_t sparse(size_t n, const double* x, const double* m, double* y)
+		{
+			size_t k = 0;
+
+			for (size_t i = 0; i < n; ++i) {
+				if (keep(m[i])) {
+					y[k++] = x[i];
+				}
+			}
+
+			return k;
+		}
+
+		// Always write, only advance when kept. The last item is guarded so
+		// nothing is written past the kept items.
+		inline size_t branchless(size_t n, const double* x, const double* m, double* y)
+		{
+			size_t k = 0;
+
+			if (n > 0) {
+				for (size_t i = 0; i + 1 < n; ++i) {
+					y[k] = x[i];
+					k += keep(m[i]);
+				}
+				if (keep(m[n - 1])) {
+					y[k++] = x[n - 1];
+				}
+			}
+
+			return k;
+		}
+
+#if defined(__AVX2__)
+		// 32-bit lane permutation moving doubles selected by a 4-bit mask to the front
+		struct left_pack_table {
+			alignas(32) int idx[16][8];
+			constexpr left_pack_table()
+				: idx{}
+			{
+				for (int b = 0; b < 16; ++b) {
+					int k = 0;
+					for (int j = 0; j < 4; ++j) {
+						if (b & (1 << j)) {
+							idx[b][2 * k] = 2 * j;
+							idx[b][2 * k + 1] = 2 * j + 1;
+							++k;
+						}
+					}
+				}
+			}
+		};
+		inline constexpr left_pack_table left_pack{};
+
+		// Many items kept: left pack 4 doubles at a time.
+		inline size_t dense(size_t n, const double* x, const double* m, double* y)
+		{
+			size_t i = 0, k = 0;
+			const __m256d zero = _mm256_setzero_pd();
+			const __m256i lane = _mm256_setr_epi64x(0, 1, 2, 3);
+
+			for (; i + 4 <= n; i += 4) {
+				int b = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(m + i), zero, _CMP_NEQ_UQ));
+				__m256i p = _mm256_load_si256(reinterpret_cast<const __m256i*>(left_pack.idx[b]));
+				__m256d v = _mm256_castps_pd(_mm256_permutevar8x32_ps(_mm256_castpd_ps(_mm256_loadu_pd(x + i)), p));
+				int c = std::popcount(static_cast<unsigned>(b));
+				// store only the packed lanes
+				_mm256_maskstore_pd(y + k, _mm256_cmpgt_epi64(_mm256_set1_epi64x(c), lane), v);
+				k += c;
+			}
+
+			return k + branchless(n - i, x + i, m + i, y + k);
+		}
+#else
+		inline size_t dense(size_t n, const double* x, const double* m, double* y)
+		{
+			return branchless(n, x, m, y);
+		}
+#endif
+
+		// Compact n doubles with contiguous mask m choosing the kernel by selectivity.
+		// Writes never get ahead of reads so y may equal x.
+		inline size_t kernel(size_t n, const double* x, const double* m, double* y)
+		{
+			size_t c = std::count_if(m, m + n, keep);
+
+			if (c == 0) {
+				return 0;
+			}
+			if (c == n) {
+				if (y != x) {
+					std::memmove(y, x, n * sizeof(double));
+				}
+
+				return n;
+			}
+
+			return 8 * c < n ? sparse(n, x, m, y) : dense(n, x, m, y);
+		}
+
+		// Compact n items of width w in place where item i has mask m[(o + i) % nm].
+		inline size_t block(double* x, size_t n, size_t w, size_t o, const double* m, size_t nm)
+		{
+			size_t k = 0;
+
+			if (w == 1) {
+				for (size_t i = 0; i < n; ) {
+					size_t j = (o + i) % nm;
+					size_t len = std::min(n - i, nm - j);
+					k += kernel(len, x + i, m + j, x + k);
+					i += len;
+				}
+			}
+			else {
+				for (size_t i = 0; i < n; ++i) {
+					if (keep(m[(o + i) % nm])) {
+						if (k != i) {
+							std::memmove(x + k * w, x + i * w, w * sizeof(double));
+						}
+						++k;
+					}
+				}
+			}
+
+			return k;
+		}
+
+		// Keep x[i] where p(x[i], y[(o + i) % ny]) is true without materializing a mask.
+		template<class P>
+		inline size_t block_if(double* x, size_t n, size_t o, const double* y, size_t ny, P p)
+		{
+			size_t k = 0;
+
+			for (size_t i = 0; i < n; ) {
+				size_t j = (o + i) % ny;
+				size_t len = std::min(n - i, ny - j);
+				double* xi = x + i;
+				const double* yj = y + j;
+				for (size_t l = 0; l + 1 < len; ++l) {
+					double xl = xi[l];
+					x[k] = xl;
+					k += static_cast<bool>(p(xl, yj[l]));
+				}
+				if (p(xi[len - 1], yj[len - 1])) {
+					x[k++] = xi[len - 1];
+				}
+				i += len;
+			}
+
+			return k;
+		}
+
+		// Compact n items of width w in place, f(o, m) compacts items [o, o + m) and returns the number kept.
+		// Blocks are compacted in parallel then moved down to their prefix offsets.
+		template<class F>
+		inline size_t blocks(double* x, size_t n, size_t w, F f)
+		{
+			const size_t b = std::max<size_t>(1, compact_block / w); // items per block
+			const size_t nb = (n + b - 1) / b;
+
+			if (nb <= 1) {
+				return n ? f(size_t(0), n) : 0;
+			}
+
+			std::vector<size_t> count(nb);
+			parallel_for(nb, [=, &count](size_t i) {
+				size_t o = i * b;
+				count[i] = f(o, std::min(b, n - o));
+			});
+
+			// offsets never exceed block starts so moving in order is safe
+			size_t k = count[0];
+			for (size_t i = 1; i < nb; ++i) {
+				if (k != i * b) {
+					std::memmove(x + k * w, x + i * b * w, count[i] * w * sizeof(double));
+				}
+				k += count[i];
+			}
+
+			return k;
+		}
+	}
+
+	// Compact n items of width w in place using cyclic mask m of size nm.
+	// Return the number of items kept.
+	inline size_t compact(double* x, size_t n, size_t w, const double* m, size_t nm)
+	{
+		if (w == 0 || nm == 0) {
+			return nm == 0 ? n : 0;
+		}
+
+		return compact_::blocks(x, n, w, [=](size_t o, size_t k) {
+			return compact_::block(x + o * w, k, w, o, m, nm);
+		});
+	}
+
+	// Compact n doubles in place keeping x[i] where p(x[i], y[i % ny]) is true.
+	// Return the number of items kept.
+	template<class P>
+	inline size_t compact_if(double* x, size_t n, const double* y, size_t ny, P p)
+	{
+		if (ny == 0) {
+			return 0;
+		}
+
+		return compact_::blocks(x, n, 1, [=](size_t o, size_t k) {
+			return compact_::block_if(x + o, k, o, y, ny, p);
+		});
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int compact_test()
+	{
+		{
+			double x[] = { 1, 2, 3, 4, 5 };
+			double m[] = { 1, 0, 0, 1, 1 };
+			assert(3 == compact(x, 5, 1, m, 5));
+			assert(x[0] == 1 && x[1] == 4 && x[2] == 5);
+		}
+		{
+			double x[] = { 1, 2, 3, 4, 5 };
+			double m[] = { 0, 1 };
+			assert(2 == compact(x, 5, 1, m, 2));
+			assert(x[0] == 2 && x[1] == 4);
+		}
+		{
+			// rows
+			double x[] = { 1, 2, 3, 4, 5, 6 };
+			double m[] = { 0, 1, 1 };
+			assert(2 == compact(x, 3, 2, m, 3));
+			assert(x[0] == 3 && x[1] == 4 && x[2] == 5 && x[3] == 6);
+		}
+		{
+			// all selectivities and several blocks
+			size_t block = compact_block;
+			compact_block = 64;
+			for (size_t s : {0, 1, 7, 50, 93, 100}) {
+				size_t n = 1003;
+				std::vector<double> x(n), m(n), y;
+				for (size_t i = 0; i < n; ++i) {
+					x[i] = double(i);
+					m[i] = (i * 7919) % 100 < s;
+					if (m[i]) {
+						y.push_back(x[i]);
+					}
+				}
+				size_t k = compact(x.data(), n, 1, m.data(), n);
+				assert(k == y.size());
+				assert(std::equal(y.begin(), y.end(), x.begin()));
+			}
+			compact_block = block;
+		}
+		{
+			double x[] = { 1, 2, 3, 4, 5 };
+			double y[] = { 3 };
+			assert(2 == compact_if(x, 5, y, 1, std::greater<double>{}));
+			assert(x[0] == 4 && x[1] == 5);
+		}
+		{
+			size_t block = compact_block;
+			compact_block = 16;
+			std::vector<double> x(100), y = { 10, 90 };
+			for (size_t i = 0; i < x.size(); ++i) {
+				x[i] = double(i);
+			}
+			// x[i] < 10 for even i, x[i] < 90 for odd i
+			size_t k = compact_if(x.data(), x.size(), y.data(), y.size(), std::less<double>{});
+			assert(k == 5 + 45);
+			assert(x[0] == 0 && x[9] == 9 && x[10] == 11 && x[k - 1] == 89);
+			compact_block = block;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_compact.t.cpp - compaction tests
+#include "fms_compact.h"
+
+#ifdef _DEBUG
+int fms_compact_test = fms::compact_test();
+#endif // _DEBUG
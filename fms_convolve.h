@@ -0,0 +1,157 @@
+// fms_convolve.h - convolution and cross-correlation
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <complex>
+#include <vector>
+#include "fms_fft.h"
+#include "fms_parallel.h"
+#include "fms_pool.h"
+
+namespace fms {
+
+	inline const char convolve_doc[] = R"xyzyx(
+The <em>convolution</em> of \(x_0,\ldots,x_{n-1}\) and \(h_0,\ldots,h_{m-1}\) is
+\(y_k = \sum_j h_j x_{k - j}\) for \(0\le k < n + m - 1\).
+The <em>cross-correlation</em> is \(r_l = \sum_t x_{t + l} y_t\) for \(-m < l < n\).
+Short kernels are convolved directly and long kernels use FFT overlap-add.
+)xyzyx";
+
+	// shortest kernel convolved using the FFT
+	inline size_t convolve_crossover = 64;
+	// number of outputs computed by one direct task
+	inline size_t convolve_block = 1 << 12;
+
+	namespace convolve_ {
+
+		// y[k] = sum_j h[j] x[k - j] for k in [k0, k1)
+		inline void direct(size_t n, const double* x, size_t m, const double* h, double* y, size_t k0, size_t k1)
+		{
+			std::fill(y + k0, y + k1, 0.);
+			for (size_t j = 0; j < m; ++j) {
+				const double hj = h[j];
+				const size_t kb = std::max(k0, j);
+				const size_t ke = std::min(k1, j + n);
+				for (size_t k = kb; k < ke; ++k) {
+					y[k] += hj * x[k - j];
+				}
+			}
+		}
+
+		// Blocks of x of length L are convolved with h using transforms of size N >= L + m - 1
+		// in parallel and the overlapping tails added in order.
+		inline void overlap_add(size_t n, const double* x, size_t m, const double* h, double* y)
+		{
+			const size_t N = std::bit_ceil(2 * m);
+			const size_t L = N - m + 1;
+			const size_t nb = (n + L - 1) / L;
+			const fft_plan f(N);
+
+			pool_vector<std::complex<double>> H(N);
+			std::copy(h, h + m, H.begin());
+			f(H.data());
+
+			pool_vector<std::complex<double>> Y(nb * N);
+			parallel_for(nb, [&, n, x](size_t b) {
+				std::complex<double>* Yb = Y.data() + b * N;
+				const size_t o = b * L;
+				std::copy(x + o, x + std::min(n, o + L), Yb);
+				f(Yb);
+				for (size_t k = 0; k < N; ++k) {
+					Yb[k] *= H[k];
+				}
+				f(Yb, true);
+			});
+
+			const size_t ny = n + m - 1;
+			std::fill(y, y + ny, 0.);
+			for (size_t b = 0; b < nb; ++b) {
+				const size_t o = b * L;
+				const std::complex<double>* Yb = Y.data() + b * N;
+				for (size_t k = 0; k < N && o + k < ny; ++k) {
+					y[o + k] += Yb[k].real();
+				}
+			}
+		}
+	}
+
+	// Set y of size n + m - 1 to the convolution of x and h.
+	inline void convolve(size_t n, const double* x, size_t m, const double* h, double* y)
+	{
+		if (n == 0 || m == 0) {
+			return;
+		}
+		if (m > n) {
+			std::swap(n, m);
+			std::swap(x, h);
+		}
+
+		if (m < convolve_crossover) {
+			const size_t ny = n + m - 1;
+			const size_t nb = (ny + convolve_block - 1) / convolve_block;
+			parallel_for(nb, [=](size_t b) {
+				convolve_::direct(n, x, m, h, y, b * convolve_block, std::min(ny, (b + 1) * convolve_block));
+			});
+		}
+		else {
+			convolve_::overlap_add(n, x, m, h, y);
+		}
+	}
+
+	// Set r of size n + m - 1 to the cross-correlation of x and y at lags 1 - m, ..., n - 1.
+	inline void xcorr(size_t n, const double* x, size_t m, const double* y, double* r)
+	{
+		pool_vector<double> y_(y, y + m);
+		std::reverse(y_.begin(), y_.end());
+
+		convolve(n, x, m, y_.data(), r);
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int convolve_test()
+	{
+		{
+			double x[] = { 1, 2, 3 };
+			double h[] = { 1, 1 };
+			double y[4];
+			convolve(3, x, 2, h, y);
+			assert(y[0] == 1 && y[1] == 3 && y[2] == 5 && y[3] == 3);
+			convolve(2, h, 3, x, y);
+			assert(y[0] == 1 && y[1] == 3 && y[2] == 5 && y[3] == 3);
+			xcorr(3, x, 2, h, y);
+			assert(y[0] == 1 && y[1] == 3 && y[2] == 5 && y[3] == 3);
+			double g[] = { 1, 0 };
+			xcorr(3, x, 2, g, y);
+			// r[l] = x[l] for l = -1, 0, 1, 2
+			assert(y[0] == 0 && y[1] == 1 && y[2] == 2 && y[3] == 3);
+		}
+		{
+			// direct and overlap-add agree
+			size_t crossover = convolve_crossover, block = convolve_block;
+			convolve_block = 16;
+			size_t n = 1000, m = 70;
+			std::vector<double> x(n), h(m), y(n + m - 1), z(n + m - 1);
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = std::sin(1. + i * i);
+			}
+			for (size_t j = 0; j < m; ++j) {
+				h[j] = std::cos(1. + j);
+			}
+			convolve_crossover = m + 1;
+			convolve(n, x.data(), m, h.data(), y.data());
+			convolve_crossover = m;
+			convolve(n, x.data(), m, h.data(), z.data());
+			for (size_t k = 0; k < y.size(); ++k) {
+				assert(std::fabs(y[k] - z[k]) < 1e-10);
+			}
+			convolve_crossover = crossover;
+			convolve_block = block;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_convolve.t.cpp - convolution tests
+#include "fms_convolve.h"
+
+#ifdef _DEBUG
+int fms_convolve_test = fms::convolve_test();
+#endif // _DEBUG
@@ -0,0 +1,279 @@
+// fms_cov.h - covariance and correlation matrices
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <utility>
+#include <vector>
+#include "fms_parallel.h"
+#include "fms_pool.h"
+#include "fms_transpose.h"
+
+namespace fms {
+
+	inline const char cov_doc[] = R"xyzyx(
+The <em>covariance matrix</em> of the columns of an n x c array of observations \(x\)
+with weights \(w_t\) is \(\sum_t w_t (x_{ti} - m_i)(x_{tj} - m_j)/(W - d)\) where
+\(W = \sum_t w_t\), \(m_i = \sum_t w_t x_{ti}/W\), and \(d\) is 1 for equal weights and 0 otherwise.
+If the observations are <em>pairwise complete</em> then the sums for each pair of columns
+are taken over the rows where neither is NaN.
+)xyzyx";
+
+	// columns of the result computed by one task
+	inline size_t cov_tile = 32;
+	// observations accumulated per pass over a tile
+	inline size_t cov_depth = 512;
+
+	namespace cov_ {
+
+		// s(i, j) += z_i . z_j for i in [i0, i1), j in [j0, min(j1, i + 1)) where z is c x n.
+		inline void tile(size_t n, size_t c, const double* z, double* s, size_t i0, size_t i1, size_t j0, size_t j1)
+		{
+			for (size_t k0 = 0; k0 < n; k0 += cov_depth) {
+				const size_t k1 = std::min(n, k0 + cov_depth);
+				for (size_t i = i0; i < i1; ++i) {
+					const double* zi = z + i * n;
+					const size_t je = std::min(j1, i + 1);
+					size_t j = j0;
+					for (; j + 4 <= je; j += 4) {
+						const double* z0 = z + j * n;
+						const double* z1 = z0 + n;
+						const double* z2 = z1 + n;
+						const double* z3 = z2 + n;
+						double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+						for (size_t k = k0; k < k1; ++k) {
+							const double x = zi[k];
+							s0 += x * z0[k];
+							s1 += x * z1[k];
+							s2 += x * z2[k];
+							s3 += x * z3[k];
+						}
+						s[i * c + j] += s0;
+						s[i * c + j + 1] += s1;
+						s[i * c + j + 2] += s2;
+						s[i * c + j + 3] += s3;
+					}
+					for (; j < je; ++j) {
+						const double* zj = z + j * n;
+						double s0 = 0;
+						for (size_t k = k0; k < k1; ++k) {
+							s0 += zi[k] * zj[k];
+						}
+						s[i * c + j] += s0;
+					}
+				}
+			}
+		}
+
+		// covariance or correlation of x and y over observations where neither is NaN
+		inline double pair(size_t n, const double* x, const double* y, const double* w, double d, bool corr)
+		{
+			double W = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+
+			for (size_t t = 0; t < n; ++t) {
+				if (x[t] == x[t] && y[t] == y[t]) {
+					const double u = w ? w[t] : 1;
+					W += u;
+					sx += u * x[t];
+					sy += u * y[t];
+					sxx += u * x[t] * x[t];
+					syy += u * y[t] * y[t];
+					sxy += u * x[t] * y[t];
+				}
+			}
+			if (W <= d) {
+				return NAN;
+			}
+
+			const double cxy = sxy - sx * sy / W;
+			if (corr) {
+				return cxy / std::sqrt((sxx - sx * sx / W) * (syy - sy * sy / W));
+			}
+
+			return cxy / (W - d);
+		}
+
+		// tiles (I, J) with J <= I of the lower triangle of a c x c matrix
+		inline std::vector<std::pair<size_t, size_t>> tiles(size_t c)
+		{
+			const size_t nt = (c + cov_tile - 1) / cov_tile;
+			std::vector<std::pair<size_t, size_t>> ij;
+
+			ij.reserve(nt * (nt + 1) / 2);
+			for (size_t i = 0; i < nt; ++i) {
+				for (size_t j = 0; j <= i; ++j) {
+					ij.emplace_back(i * cov_tile, j * cov_tile);
+				}
+			}
+
+			return ij;
+		}
+
+		// Tiles are skipped once *cancel is set.
+		inline void matrix(size_t n, size_t c, const double* x, double* s, const double* w, bool pairwise, bool corr,
+			const std::atomic<bool>* cancel)
+		{
+			auto cancelled = [cancel] { return cancel && cancel->load(std::memory_order_relaxed); };
+
+			const double d = w ? 0 : 1;
+			double W = w ? 0 : static_cast<double>(n);
+			if (w) {
+				for (size_t t = 0; t < n; ++t) {
+					W += w[t];
+				}
+			}
+
+			// observations of each column are contiguous
+			pool_vector<double> z(c * n);
+			transpose(n, c, x, z.data());
+
+			// center, and scale by the square root of the weights unless pairwise
+			parallel_for(c, [=, &z](size_t i) {
+				double* zi = z.data() + i * n;
+				double m = 0, u = 0;
+				for (size_t t = 0; t < n; ++t) {
+					if (!pairwise || zi[t] == zi[t]) {
+						m += (w ? w[t] : 1) * zi[t];
+						u += w ? w[t] : 1;
+					}
+				}
+				m /= u;
+				for (size_t t = 0; t < n; ++t) {
+					zi[t] -= m;
+					if (w && !pairwise) {
+						zi[t] *= std::sqrt(w[t]);
+					}
+				}
+			});
+
+			std::fill(s, s + c * c, 0.);
+			if (cancelled()) {
+				return;
+			}
+			const auto ij = tiles(c);
+			parallel_for(ij.size(), [=, &z, &ij](size_t k) {
+				if (cancelled()) {
+					return;
+				}
+				const auto& t = ij[k];
+				const size_t i1 = std::min(c, t.first + cov_tile);
+				const size_t j1 = std::min(c, t.second + cov_tile);
+				if (pairwise) {
+					for (size_t i = t.first; i < i1; ++i) {
+						for (size_t j = t.second; j < std::min(j1, i + 1); ++j) {
+							s[i * c + j] = pair(n, z.data() + i * n, z.data() + j * n, w, d, corr);
+						}
+					}
+				}
+				else {
+					tile(n, c, z.data(), s, t.first, i1, t.second, j1);
+				}
+			});
+
+			if (!pairwise) {
+				for (size_t i = 0; i < c; ++i) {
+					for (size_t j = 0; j <= i; ++j) {
+						s[i * c + j] /= W - d;
+					}
+				}
+				if (corr) {
+					for (size_t i = 0; i < c; ++i) {
+						for (size_t j = 0; j < i; ++j) {
+							s[i * c + j] /= std::sqrt(s[i * c + i] * s[j * c + j]);
+						}
+					}
+					for (size_t i = 0; i < c; ++i) {
+						s[i * c + i] = s[i * c + i] == s[i * c + i] ? 1 : NAN;
+					}
+				}
+			}
+
+			for (size_t i = 0; i < c; ++i) {
+				for (size_t j = 0; j < i; ++j) {
+					s[j * c + i] = s[i * c + j];
+				}
+			}
+		}
+	}
+
+	// Set the c x c array cov to the covariance matrix of the columns of the n x c array x.
+	// Weights w of size n are optional. If pairwise then NaN observations are skipped pair by pair.
+	// If cancel is set while running the result is incomplete.
+	inline void covariance(size_t n, size_t c, const double* x, double* cov, const double* w = nullptr, bool pairwise = false,
+		const std::atomic<bool>* cancel = nullptr)
+	{
+		cov_::matrix(n, c, x, cov, w, pairwise, false, cancel);
+	}
+
+	// Set the c x c array cor to the correlation matrix of the columns of the n x c array x.
+	inline void correlation(size_t n, size_t c, const double* x, double* cor, const double* w = nullptr, bool pairwise = false,
+		const std::atomic<bool>* cancel = nullptr)
+	{
+		cov_::matrix(n, c, x, cor, w, pairwise, true, cancel);
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int cov_test()
+	{
+		{
+			double x[] = { 1, 2, 2, 4, 3, 6 };
+			double s[4];
+			covariance(3, 2, x, s);
+			assert(s[0] == 1 && s[1] == 2 && s[2] == 2 && s[3] == 4);
+			correlation(3, 2, x, s);
+			assert(s[0] == 1 && std::fabs(s[1] - 1) < 1e-15 && s[1] == s[2] && s[3] == 1);
+		}
+		{
+			// agrees with pairwise when there are no NaN
+			size_t tile = cov_tile, depth = cov_depth;
+			cov_tile = 4;
+			cov_depth = 8;
+			size_t n = 50, c = 11;
+			std::vector<double> x(n * c), w(n), s(c * c), p(c * c);
+			for (size_t i = 0; i < x.size(); ++i) {
+				x[i] = std::sin(1. + i * i);
+			}
+			for (size_t t = 0; t < n; ++t) {
+				w[t] = 1. + t;
+			}
+			for (const double* w_ : { (const double*)nullptr, (const double*)w.data() }) {
+				covariance(n, c, x.data(), s.data(), w_);
+				covariance(n, c, x.data(), p.data(), w_, true);
+				for (size_t i = 0; i < s.size(); ++i) {
+					assert(std::fabs(s[i] - p[i]) < 1e-12);
+				}
+				correlation(n, c, x.data(), s.data(), w_);
+				correlation(n, c, x.data(), p.data(), w_, true);
+				for (size_t i = 0; i < s.size(); ++i) {
+					assert(std::fabs(s[i] - p[i]) < 1e-12);
+				}
+			}
+			cov_tile = tile;
+			cov_depth = depth;
+		}
+		{
+			double x[] = { 1, 2, NAN, 4, 3, 6, 4, 8 };
+			double s[4];
+			covariance(4, 2, x, s);
+			assert(s[0] != s[0] && s[1] != s[1] && s[2] != s[2] && std::fabs(s[3] - 20. / 3) < 1e-12);
+			covariance(4, 2, x, s, nullptr, true);
+			assert(std::fabs(s[0] - 7. / 3) < 1e-12);
+			assert(std::fabs(s[1] - 14. / 3) < 1e-12 && s[1] == s[2]);
+			assert(std::fabs(s[3] - 20. / 3) < 1e-12);
+		}
+		{
+			// cancelled before the tiles
+			double x[] = { 1, 2, 2, 4, 3, 6 };
+			double s[4] = { 1, 1, 1, 1 };
+			std::atomic<bool> cancel = true;
+			covariance(3, 2, x, s, nullptr, false, &cancel);
+			assert(s[0] == 0 && s[3] == 0);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_cov.t.cpp - covariance tests
+#include "fms_cov.h"
+
+#ifdef _DEBUG
+int fms_cov_test = fms::cov_test();
+#endif // _DEBUG
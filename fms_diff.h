@@ -0,0 +1,122 @@
+// fms_diff.h - lagged differences and returns
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "fms_parallel.h"
+#include "fms_pool.h"
+
+namespace fms {
+
+	// number of doubles differenced by one task
+	inline size_t diff_block = 1 << 16;
+
+	enum class diff_mode {
+		difference, // x[t] - x[t - k]
+		percent,    // x[t]/x[t - k] - 1
+		log         // log(x[t]/x[t - k])
+	};
+
+	namespace diff_ {
+
+		inline double op(diff_mode mode, double x, double x_)
+		{
+			switch (mode) {
+			case diff_mode::percent:
+				return x / x_ - 1;
+			case diff_mode::log:
+				return std::log(x / x_);
+			default:
+				return x - x_;
+			}
+		}
+
+		template<diff_mode mode>
+		inline void row(size_t w, double* y, const double* y_)
+		{
+			for (size_t j = 0; j < w; ++j) {
+				y[j] = op(mode, y[j], y_[j]);
+			}
+		}
+
+		// rows [b, e) of width w in place, prev holds the original rows [b - k, b)
+		template<diff_mode mode>
+		inline void block(double* x, size_t w, size_t k, size_t b, size_t e, const double* prev)
+		{
+			for (size_t t = e; t-- > std::max(b, k); ) {
+				const double* x_ = t - k >= b ? x + (t - k) * w : prev + (t - k - (b - k)) * w;
+				row<mode>(w, x + t * w, x_);
+			}
+			if (mode != diff_mode::difference && b < k) {
+				std::fill(x + b * w, x + std::min(e, k) * w, NAN);
+			}
+		}
+	}
+
+	// Replace rows of the n x w array x by lag k differences in place.
+	// The first k rows are unchanged for differences and NaN for returns.
+	// Blocks of rows are differenced in parallel after saving the k rows preceding each block.
+	template<diff_mode mode = diff_mode::difference>
+	inline void diff(double* x, size_t n, size_t w, size_t k = 1)
+	{
+		if (n == 0 || w == 0 || k == 0) {
+			return;
+		}
+
+		const size_t b = std::max(k, diff_block / w); // rows per block
+		const size_t nb = (n + b - 1) / b;
+
+		pool_vector<double> prev(nb * k * w);
+		for (size_t i = 1; i < nb; ++i) {
+			std::copy(x + (i * b - k) * w, x + i * b * w, prev.begin() + i * k * w);
+		}
+
+		parallel_for(nb, [=, &prev](size_t i) {
+			diff_::block<mode>(x, w, k, i * b, std::min(n, (i + 1) * b), prev.data() + i * k * w);
+		});
+	}
+	inline void diff(diff_mode mode, double* x, size_t n, size_t w, size_t k = 1)
+	{
+		switch (mode) {
+		case diff_mode::percent:
+			diff<diff_mode::percent>(x, n, w, k);
+			break;
+		case diff_mode::log:
+			diff<diff_mode::log>(x, n, w, k);
+			break;
+		default:
+			diff<diff_mode::difference>(x, n, w, k);
+		}
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int diff_test()
+	{
+		size_t block = diff_block;
+		diff_block = 4;
+		{
+			double x[] = { 1, 2, 4, 7, 11, 16, 22, 29, 37 };
+			diff(x, 9, 1);
+			double y[] = { 1, 1, 2, 3, 4, 5, 6, 7, 8 };
+			assert(std::equal(x, x + 9, y));
+			diff(x, 9, 1, 2);
+			double z[] = { 1, 1, 1, 2, 2, 2, 2, 2, 2 };
+			assert(std::equal(x, x + 9, z));
+		}
+		{
+			// 3 x 2 column-wise returns
+			double x[] = { 1, 2, 2, 1, 4, 4 };
+			diff<diff_mode::percent>(x, 3, 2);
+			assert(std::isnan(x[0]) && std::isnan(x[1]));
+			assert(x[2] == 1 && x[3] == -0.5);
+			assert(x[4] == 1 && x[5] == 3);
+		}
+		diff_block = block;
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_diff.t.cpp - difference tests
+#include "fms_diff.h"
+
+#ifdef _DEBUG
+int fms_diff_test = fms::diff_test();
+#endif // _DEBUG
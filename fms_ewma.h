@@ -0,0 +1,236 @@
+// fms_ewma.h - exponentially weighted moving statistics
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "fms_cov.h"
+#include "fms_monoid.h"
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char ewma_doc[] = R"xyzyx(
+The <em>exponentially weighted moving average</em> is <code>m<sub>t</sub> = &lambda; m<sub>t-1</sub> + (1 - &lambda;) x<sub>t</sub></code>
+with <code>m<sub>0</sub> = x<sub>0</sub></code>. Each step is the affine map <code>m &rarr; a m + b</code>
+and affine maps form a monoid under composition so the recurrence can be computed
+by a parallel scan.
+)xyzyx";
+
+	// number of time steps scanned by one task
+	inline size_t ewma_block = 1 << 14;
+
+	// m -> a m + b
+	template<class X>
+	struct affine {
+		X a, b;
+
+		X operator()(const X& m) const
+		{
+			return a * m + b;
+		}
+	};
+
+	// first f then g
+	template<class X>
+	inline affine<X> then(const affine<X>& f, const affine<X>& g)
+	{
+		return { g.a * f.a, g.a * f.b + g.b };
+	}
+
+	// Composition of affine maps, not commutative.
+	template<class X>
+	struct monoid_affine : public monoid<affine<X>> {
+		affine<X> _op() const override
+		{
+			return { X(1), X(0) };
+		}
+		affine<X> _op(const affine<X>& f, const affine<X>& g) const override
+		{
+			return then(f, g);
+		}
+	};
+
+	// y[t, j] = lambda y[t - 1, j] + (1 - lambda) x[t, j] for each column of the n x c array x and y[-1, j] = x[0, j].
+	// Blocks of rows are scanned in parallel from zero then fixed up with the composed prefix of previous blocks.
+	inline void ewma(size_t n, size_t c, const double* x, double lambda, double* y)
+	{
+		if (n == 0 || c == 0) {
+			return;
+		}
+
+		const size_t b = ewma_block;
+		const size_t nb = (n + b - 1) / b;
+
+		parallel_for(nb, [=](size_t i) {
+			const size_t t0 = i * b;
+			for (size_t j = 0; j < c; ++j) {
+				y[t0 * c + j] = (1 - lambda) * x[t0 * c + j];
+			}
+			for (size_t t = t0 + 1; t < std::min(n, t0 + b); ++t) {
+				const double* xt = x + t * c;
+				const double* y_ = y + (t - 1) * c;
+				double* yt = y + t * c;
+				for (size_t j = 0; j < c; ++j) {
+					yt[j] = lambda * y_[j] + (1 - lambda) * xt[j];
+				}
+			}
+		});
+
+		// value entering each block, every block before the last has b rows
+		double a = 1;
+		for (size_t t = 0; t < b && nb > 1; ++t) {
+			a *= lambda;
+		}
+		std::vector<double> m(nb * c);
+		std::copy(x, x + c, m.begin());
+		for (size_t i = 1; i < nb; ++i) {
+			const double* yb = y + (i * b - 1) * c;
+			for (size_t j = 0; j < c; ++j) {
+				m[i * c + j] = a * m[(i - 1) * c + j] + yb[j];
+			}
+		}
+
+		parallel_for(nb, [=, &m](size_t i) {
+			const double* mi = m.data() + i * c;
+			double a = 1;
+			for (size_t t = i * b; t < std::min(n, (i + 1) * b); ++t) {
+				a *= lambda;
+				double* yt = y + t * c;
+				for (size_t j = 0; j < c; ++j) {
+					yt[j] += a * mi[j];
+				}
+			}
+		});
+	}
+	inline void ewma(size_t n, const double* x, double lambda, double* y)
+	{
+		ewma(n, 1, x, lambda, y);
+	}
+
+	// Weights w[t] with sum_t w[t] x[t] equal to the last exponentially weighted moving average.
+	inline void ewma_weights(size_t n, double lambda, double* w)
+	{
+		if (n == 0) {
+			return;
+		}
+
+		double a = 1;
+		for (size_t t = n; t-- > 0; ) {
+			w[t] = (1 - lambda) * a;
+			a *= lambda;
+		}
+		w[0] += a; // initial value
+	}
+
+	// Exponentially weighted variance of each column of the n x c array x.
+	// d = x[t] - m, m += (1 - lambda) d, v = lambda (v + (1 - lambda) d^2) with m = x[0] and v = 0.
+	inline void ewma_variance(size_t n, size_t c, const double* x, double lambda, double* y)
+	{
+		if (n == 0 || c == 0) {
+			return;
+		}
+
+		std::vector<double> m(x, x + c);
+		std::fill(y, y + c, 0.);
+		for (size_t t = 1; t < n; ++t) {
+			const double* xt = x + t * c;
+			const double* v = y + (t - 1) * c;
+			double* yt = y + t * c;
+			for (size_t j = 0; j < c; ++j) {
+				double d = xt[j] - m[j];
+				m[j] += (1 - lambda) * d;
+				yt[j] = lambda * (v[j] + (1 - lambda) * d * d);
+			}
+		}
+	}
+
+	// Exponentially weighted covariance matrix of the columns of the n x c array x at the last time.
+	inline void ewma_covariance(size_t n, size_t c, const double* x, double lambda, double* cov)
+	{
+		std::vector<double> w(n);
+		ewma_weights(n, lambda, w.data());
+		covariance(n, c, x, cov, w.data());
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int ewma_test()
+	{
+		size_t block = ewma_block;
+		ewma_block = 7;
+		{
+			size_t n = 100;
+			double lambda = 0.9;
+			std::vector<double> x(n), y(n), z(n), w(n);
+			for (size_t t = 0; t < n; ++t) {
+				x[t] = std::sin(double(t));
+			}
+			z[0] = x[0];
+			for (size_t t = 1; t < n; ++t) {
+				z[t] = lambda * z[t - 1] + (1 - lambda) * x[t];
+			}
+
+			ewma(n, x.data(), lambda, y.data());
+			for (size_t t = 0; t < n; ++t) {
+				assert(std::fabs(y[t] - z[t]) < 1e-12);
+			}
+
+			ewma_weights(n, lambda, w.data());
+			double s = 0;
+			for (size_t t = 0; t < n; ++t) {
+				s += w[t] * x[t];
+			}
+			assert(std::fabs(s - z[n - 1]) < 1e-12);
+
+			// scan with the monoid
+			monoid_affine<double> m;
+			affine<double> f = m();
+			for (size_t t = 1; t < n; ++t) {
+				f = m(f, affine<double>{ lambda, (1 - lambda) * x[t] });
+			}
+			assert(std::fabs(f(x[0]) - z[n - 1]) < 1e-12);
+		}
+		{
+			// two identical columns have covariance equal to variance
+			size_t n = 50;
+			std::vector<double> x(2 * n), v(2 * n), cov(4);
+			for (size_t t = 0; t < n; ++t) {
+				x[2 * t] = x[2 * t + 1] = std::cos(double(t));
+			}
+			ewma_variance(n, 2, x.data(), 0.94, v.data());
+			ewma_covariance(n, 2, x.data(), 0.94, cov.data());
+			assert(std::fabs(cov[0] - v[2 * (n - 1)]) < 1e-12);
+			assert(cov[1] == cov[2]);
+			assert(std::fabs(cov[1] - cov[0]) < 1e-12);
+
+			std::vector<double> m(2 * n);
+			ewma(n, 2, x.data(), 0.94, m.data());
+			for (size_t t = 0; t < n; ++t) {
+				assert(m[2 * t] == m[2 * t + 1]);
+			}
+		}
+		{
+			// no cancellation for a large mean
+			size_t n = 20;
+			std::vector<double> x(n), v(n);
+			for (size_t t = 0; t < n; ++t) {
+				x[t] = 1e9 + (t % 2);
+			}
+			ewma_variance(n, 1, x.data(), 0.5, v.data());
+			for (size_t t = 0; t < n; ++t) {
+				x[t] -= 1e9;
+			}
+			std::vector<double> w(n);
+			ewma_variance(n, 1, x.data(), 0.5, w.data());
+			for (size_t t = 0; t < n; ++t) {
+				assert(std::fabs(v[t] - w[t]) < 1e-12);
+			}
+		}
+		ewma_block = block;
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
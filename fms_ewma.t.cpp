@@ -0,0 +1,6 @@
+// fms_ewma.t.cpp - exponentially weighted moving statistics tests
+#include "fms_ewma.h"
+
+#ifdef _DEBUG
+int fms_ewma_test = fms::ewma_test();
+#endif // _DEBUG
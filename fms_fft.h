@@ -0,0 +1,103 @@
+// fms_fft.h - radix 2 fast Fourier transform
+#pragma once
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <numbers>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace fms {
+
+	inline const char fft_doc[] = R"xyzyx(
+The <em>discrete Fourier transform</em> of \(a_0,\ldots,a_{n-1}\) is
+\(A_k = \sum_j a_j e^{-2\pi i jk/n}\). The inverse transform uses \(e^{2\pi i jk/n}\)
+and divides by \(n\). The size \(n\) must be a power of 2.
+)xyzyx";
+
+	// Precomputed roots of unity for transforms of size n.
+	class fft_plan {
+		size_t n;
+		std::vector<std::complex<double>> w; // w[k] = exp(-2 pi i k/n), k < n/2
+	public:
+		fft_plan(size_t n)
+			: n(n), w(n / 2)
+		{
+			if (!std::has_single_bit(n)) {
+				throw std::invalid_argument("fft_plan: size must be a power of 2");
+			}
+			for (size_t k = 0; k < n / 2; ++k) {
+				double t = -2 * std::numbers::pi * k / n;
+				w[k] = std::complex<double>(std::cos(t), std::sin(t));
+			}
+		}
+		size_t size() const
+		{
+			return n;
+		}
+		// transform a in place
+		void operator()(std::complex<double>* a, bool inverse = false) const
+		{
+			for (size_t i = 1, j = 0; i < n; ++i) {
+				size_t b = n >> 1;
+				for (; j & b; b >>= 1) {
+					j ^= b;
+				}
+				j ^= b;
+				if (i < j) {
+					std::swap(a[i], a[j]);
+				}
+			}
+			for (size_t len = 2; len <= n; len <<= 1) {
+				const size_t h = len / 2, s = n / len;
+				for (size_t i = 0; i < n; i += len) {
+					for (size_t k = 0; k < h; ++k) {
+						const std::complex<double> wk = inverse ? std::conj(w[k * s]) : w[k * s];
+						const std::complex<double> u = a[i + k];
+						const std::complex<double> v = a[i + k + h] * wk;
+						a[i + k] = u + v;
+						a[i + k + h] = u - v;
+					}
+				}
+			}
+			if (inverse) {
+				for (size_t i = 0; i < n; ++i) {
+					a[i] /= static_cast<double>(n);
+				}
+			}
+		}
+	};
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int fft_test()
+	{
+		{
+			size_t n = 16;
+			fft_plan f(n);
+			std::vector<std::complex<double>> a(n), b(n);
+			for (size_t j = 0; j < n; ++j) {
+				a[j] = std::complex<double>(std::sin(1. + j * j), double(j));
+			}
+			b = a;
+			f(b.data());
+			for (size_t k = 0; k < n; ++k) {
+				std::complex<double> s = 0;
+				for (size_t j = 0; j < n; ++j) {
+					s += a[j] * std::polar(1., -2 * std::numbers::pi * j * k / n);
+				}
+				assert(std::abs(s - b[k]) < 1e-12);
+			}
+			f(b.data(), true);
+			for (size_t j = 0; j < n; ++j) {
+				assert(std::abs(a[j] - b[j]) < 1e-12);
+			}
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
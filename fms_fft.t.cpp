@@ -0,0 +1,6 @@
+// fms_fft.t.cpp - fast Fourier transform tests
+#include "fms_fft.h"
+
+#ifdef _DEBUG
+int fms_fft_test = fms::fft_test();
+#endif // _DEBUG
@@ -0,0 +1,178 @@
+// fms_gemm.h - matrix multiplication
+#pragma once
+#include <algorithm>
+#include <tuple>
+#include <vector>
+#ifdef FMS_BLAS
+#include <cblas.h>
+#endif
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char gemm_doc[] = R"xyzyx(
+Row-major matrix products <code>c = a b</code> and <code>y = a x</code>.
+Define <code>FMS_BLAS</code> to call <code>cblas_dgemm</code> and <code>cblas_dgemv</code> instead.
+)xyzyx";
+
+	namespace gemm_ {
+
+		// register block
+		constexpr size_t MR = 4;
+		constexpr size_t NR = 8;
+		// cache blocks: a block of a fits in L2, a panel of b in L3
+		constexpr size_t MC = 96;
+		constexpr size_t KC = 256;
+		constexpr size_t NC = 2048;
+
+		// Pack mc x kc block of a with leading dimension lda into MR row slivers, zero padded.
+		inline void pack_a(size_t mc, size_t kc, const double* a, size_t lda, double* p)
+		{
+			for (size_t i = 0; i < mc; i += MR) {
+				size_t mr = std::min(MR, mc - i);
+				for (size_t l = 0; l < kc; ++l) {
+					for (size_t r = 0; r < MR; ++r) {
+						*p++ = r < mr ? a[(i + r) * lda + l] : 0;
+					}
+				}
+			}
+		}
+
+		// Pack kc x nc block of b with leading dimension ldb into NR column slivers, zero padded.
+		inline void pack_b(size_t kc, size_t nc, const double* b, size_t ldb, double* p)
+		{
+			for (size_t j = 0; j < nc; j += NR) {
+				size_t nr = std::min(NR, nc - j);
+				for (size_t l = 0; l < kc; ++l) {
+					for (size_t r = 0; r < NR; ++r) {
+						*p++ = r < nr ? b[l * ldb + j + r] : 0;
+					}
+				}
+			}
+		}
+
+		// c[0:mr, 0:nr] += a sliver times b sliver, accumulated in registers
+		inline void micro(size_t kc, const double* a, const double* b, double* c, size_t ldc, size_t mr, size_t nr)
+		{
+			double t[MR][NR] = {};
+
+			for (size_t l = 0; l < kc; ++l) {
+				for (size_t i = 0; i < MR; ++i) {
+					double ai = a[l * MR + i];
+					for (size_t j = 0; j < NR; ++j) {
+						t[i][j] += ai * b[l * NR + j];
+					}
+				}
+			}
+
+			for (size_t i = 0; i < mr; ++i) {
+				for (size_t j = 0; j < nr; ++j) {
+					c[i * ldc + j] += t[i][j];
+				}
+			}
+		}
+	}
+
+	// c = a b where a is m x k, b is k x n, and c is m x n
+	inline void gemm(size_t m, size_t n, size_t k, const double* a, const double* b, double* c)
+	{
+#ifdef FMS_BLAS
+		cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, (int)m, (int)n, (int)k, 1., a, (int)k, b, (int)n, 0., c, (int)n);
+#else
+		using namespace gemm_;
+
+		std::fill(c, c + m * n, 0.);
+
+		std::vector<double> bp;
+
+		for (size_t jc = 0; jc < n; jc += NC) {
+			size_t nc = std::min(NC, n - jc);
+			for (size_t pc = 0; pc < k; pc += KC) {
+				size_t kc = std::min(KC, k - pc);
+				bp.resize(kc * ((nc + NR - 1) / NR) * NR);
+				pack_b(kc, nc, b + pc * n + jc, n, bp.data());
+
+				// row blocks of c are disjoint
+				parallel_for((m + MC - 1) / MC, [=, &bp](size_t ib) {
+					size_t ic = ib * MC;
+					size_t mc = std::min(MC, m - ic);
+					std::vector<double> ap(kc * ((mc + MR - 1) / MR) * MR);
+					pack_a(mc, kc, a + ic * k + pc, k, ap.data());
+
+					for (size_t jr = 0; jr < nc; jr += NR) {
+						for (size_t ir = 0; ir < mc; ir += MR) {
+							micro(kc, ap.data() + ir * kc, bp.data() + jr * kc,
+								c + (ic + ir) * n + jc + jr, n, std::min(MR, mc - ir), std::min(NR, nc - jr));
+						}
+					}
+				});
+			}
+		}
+#endif // FMS_BLAS
+	}
+
+	// y = a x where a is m x n
+	inline void gemv(size_t m, size_t n, const double* a, const double* x, double* y)
+	{
+#ifdef FMS_BLAS
+		cblas_dgemv(CblasRowMajor, CblasNoTrans, (int)m, (int)n, 1., a, (int)n, x, 1, 0., y, 1);
+#else
+		parallel_for(m, [=](size_t i) {
+			const double* ai = a + i * n;
+			// independent accumulators break the add dependency chain
+			double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+			size_t j = 0;
+			for (; j + 4 <= n; j += 4) {
+				s0 += ai[j] * x[j];
+				s1 += ai[j + 1] * x[j + 1];
+				s2 += ai[j + 2] * x[j + 2];
+				s3 += ai[j + 3] * x[j + 3];
+			}
+			for (; j < n; ++j) {
+				s0 += ai[j] * x[j];
+			}
+			y[i] = (s0 + s1) + (s2 + s3);
+		});
+#endif // FMS_BLAS
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int gemm_test()
+	{
+		for (auto [m, n, k] : { std::tuple<size_t, size_t, size_t>{1, 1, 1}, {2, 3, 4}, {7, 9, 5}, {100, 37, 300} }) {
+			std::vector<double> a(m * k), b(k * n), c(m * n), d(m * n, 0.), y(m), z(m, 0.);
+			for (size_t i = 0; i < a.size(); ++i) {
+				a[i] = double(i % 7) - 3;
+			}
+			for (size_t i = 0; i < b.size(); ++i) {
+				b[i] = double(i % 5) - 2;
+			}
+			for (size_t i = 0; i < m; ++i) {
+				for (size_t j = 0; j < n; ++j) {
+					for (size_t l = 0; l < k; ++l) {
+						d[i * n + j] += a[i * k + l] * b[l * n + j];
+					}
+				}
+				for (size_t l = 0; l < k; ++l) {
+					z[i] += a[i * k + l] * b[l * n];
+				}
+			}
+
+			gemm(m, n, k, a.data(), b.data(), c.data());
+			assert(c == d); // small integers are exact
+
+			std::vector<double> x(k);
+			for (size_t l = 0; l < k; ++l) {
+				x[l] = b[l * n];
+			}
+			gemv(m, k, a.data(), x.data(), y.data());
+			assert(y == z);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
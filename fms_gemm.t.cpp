@@ -0,0 +1,6 @@
+// fms_gemm.t.cpp - matrix multiplication tests
+#include "fms_gemm.h"
+
+#ifdef _DEBUG
+int fms_gemm_test = fms::gemm_test();
+#endif // _DEBUG
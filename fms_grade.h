@@ -0,0 +1,384 @@
+// fms_grade.h - sort permutations and ranks
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <vector>
+#include "fms_parallel.h"
+#include "fms_pool.h"
+
+namespace fms {
+
+	inline const char grade_doc[] = R"xyzyx(
+The <em>grade</em> of an array is the permutation of indices that sorts it.
+The grade is stable so equal values keep their original order, and NaN values
+come last. Given the grade, order statistics are \(O(1)\) and the rank of
+any value is \(O(\log n)\).
+)xyzyx";
+
+	// number of indices sorted by one task
+	inline size_t grade_block = 1 << 16;
+	// segments no longer than this are graded by insertion sort
+	inline size_t grade_small = 16;
+
+	namespace grade_ {
+
+		// increasing with NaN last
+		inline bool less(double x, double y)
+		{
+			return x < y || (std::isnan(y) && !std::isnan(x));
+		}
+
+		// decreasing with NaN last
+		inline bool greater(double x, double y)
+		{
+			return x > y || (std::isnan(y) && !std::isnan(x));
+		}
+
+		// Stable grade of the n items x[i * s] into p[i * s].
+		template<class C>
+		inline void segment(size_t n, const double* x, size_t s, double* p, C lt)
+		{
+			pool_vector<double> q(n);
+			std::iota(q.begin(), q.end(), 0.);
+			auto cmp = [=](double i, double j) { return lt(x[(size_t)i * s], x[(size_t)j * s]); };
+
+			if (n <= grade_small) {
+				// insertion sort is stable
+				for (size_t i = 1; i < n; ++i) {
+					double v = q[i];
+					size_t j = i;
+					for (; j > 0 && cmp(v, q[j - 1]); --j) {
+						q[j] = q[j - 1];
+					}
+					q[j] = v;
+				}
+			}
+			else {
+				std::stable_sort(q.begin(), q.end(), cmp);
+			}
+			for (size_t i = 0; i < n; ++i) {
+				p[i * s] = q[i];
+			}
+		}
+
+		// Merge sorted runs of width b from p to q in parallel.
+		inline void merge(const double* x, size_t n, size_t b, const double* p, double* q)
+		{
+			auto lt = [x](double i, double j) { return less(x[(size_t)i], x[(size_t)j]); };
+			const size_t m = (n + 2 * b - 1) / (2 * b);
+
+			parallel_for(m, [=](size_t k) {
+				size_t lo = k * 2 * b;
+				size_t mid = std::min(n, lo + b);
+				size_t hi = std::min(n, lo + 2 * b);
+				std::merge(p + lo, p + mid, p + mid, p + hi, q + lo, lt);
+			});
+		}
+	}
+
+	// Stable increasing grade p of x, NaN last. Indices are stored as doubles.
+	inline void grade(size_t n, const double* x, double* p)
+	{
+		const size_t b = grade_block;
+		const size_t nb = (n + b - 1) / b;
+
+		std::iota(p, p + n, 0.);
+		parallel_for(nb, [=](size_t i) {
+			std::stable_sort(p + i * b, p + std::min(n, (i + 1) * b), [x](double i, double j) {
+				return grade_::less(x[(size_t)i], x[(size_t)j]);
+			});
+		});
+
+		if (nb > 1) {
+			pool_vector<double> q(n);
+			double* from = p;
+			double* to = q.data();
+			for (size_t w = b; w < n; w *= 2) {
+				grade_::merge(x, n, w, from, to);
+				std::swap(from, to);
+			}
+			if (from != p) {
+				std::copy(from, from + n, p);
+			}
+		}
+	}
+
+	// Stable grade of each row of the r x c row-major array x, NaN last.
+	// Row i of p holds the column indices that sort row i of x.
+	inline void grade_rows(size_t r, size_t c, const double* x, double* p, bool decreasing = false)
+	{
+		parallel_for(r, [=](size_t i) {
+			if (decreasing) {
+				grade_::segment(c, x + i * c, 1, p + i * c, grade_::greater);
+			}
+			else {
+				grade_::segment(c, x + i * c, 1, p + i * c, grade_::less);
+			}
+		}, std::max<size_t>(1, grade_block / 4 / std::max<size_t>(c, 1)));
+	}
+
+	// Stable grade of each column of the r x c row-major array x, NaN last.
+	// Column j of p holds the row indices that sort column j of x.
+	inline void grade_columns(size_t r, size_t c, const double* x, double* p, bool decreasing = false)
+	{
+		parallel_for(c, [=](size_t j) {
+			if (decreasing) {
+				grade_::segment(r, x + j, c, p + j, grade_::greater);
+			}
+			else {
+				grade_::segment(r, x + j, c, p + j, grade_::less);
+			}
+		}, std::max<size_t>(1, grade_block / 4 / std::max<size_t>(r, 1)));
+	}
+
+	// Number of values of x that are not NaN given its grade p.
+	inline size_t graded_count(size_t n, const double* x, const double* p)
+	{
+		return std::partition_point(p, p + n, [x](double i) { return !std::isnan(x[(size_t)i]); }) - p;
+	}
+
+	// How ties are ranked.
+	enum class rank_method {
+		min,     // lowest rank of the group, like RANK.EQ
+		average, // average rank of the group, like RANK.AVG
+		max,     // highest rank of the group
+		dense,   // number of distinct smaller values plus one
+		ordinal, // position in the stable grade
+	};
+
+	namespace rank_ {
+
+		// x[p[i]] using stride s for both x and p
+		struct graded {
+			const double* x;
+			const double* p;
+			size_t s;
+
+			double operator[](size_t i) const
+			{
+				return x[(size_t)p[i * s] * s];
+			}
+			// i starts a tie group
+			bool start(size_t i) const
+			{
+				return i == 0 || (*this)[i] != (*this)[i - 1];
+			}
+		};
+
+		// Rank graded positions [b, e) of m non-NaN values where d groups start before b.
+		inline void ranks(const graded& g, size_t m, size_t b, size_t e, size_t d, double* r, rank_method method)
+		{
+			size_t lo = b, hi = b;
+			while (lo > 0 && !g.start(lo)) {
+				--lo;
+			}
+
+			for (size_t i = b; i < e; ++i) {
+				if (g.start(i)) {
+					lo = i;
+					++d;
+				}
+				if (hi <= i) {
+					hi = i + 1;
+					while (hi < m && !g.start(hi)) {
+						++hi;
+					}
+				}
+
+				double ri = 0;
+				switch (method) {
+				case rank_method::min:
+					ri = static_cast<double>(lo + 1);
+					break;
+				case rank_method::average:
+					ri = (lo + 1 + hi) / 2.;
+					break;
+				case rank_method::max:
+					ri = static_cast<double>(hi);
+					break;
+				case rank_method::dense:
+					ri = static_cast<double>(d);
+					break;
+				case rank_method::ordinal:
+					ri = static_cast<double>(i + 1);
+					break;
+				}
+				r[(size_t)g.p[i * g.s] * g.s] = ri;
+			}
+		}
+	}
+
+	// Rank r[i] of x[i] starting at 1 given its grade p. NaN has rank NaN.
+	// Tie groups are found by a parallel scan over the grade.
+	inline void rank(size_t n, const double* x, const double* p, double* r, rank_method method = rank_method::min)
+	{
+		size_t m = graded_count(n, x, p);
+		rank_::graded g{ x, p, 1 };
+
+		parallel_scan(m, size_t(0), [&](size_t b, size_t e) {
+			size_t d = 0;
+			for (size_t i = b; i < e; ++i) {
+				d += g.start(i);
+			}
+			return d;
+		}, std::plus<size_t>{}, [&](size_t b, size_t e, size_t d) {
+			rank_::ranks(g, m, b, e, d, r, method);
+		}, grade_block / 4);
+
+		for (size_t i = m; i < n; ++i) {
+			r[(size_t)p[i]] = NAN;
+		}
+	}
+
+	// Rank each column of the r x c row-major array x in parallel, NaN has rank NaN.
+	inline void rank_columns(size_t r, size_t c, const double* x, double* y, rank_method method = rank_method::min)
+	{
+		pool_vector<double> p(r * c);
+		grade_columns(r, c, x, p.data());
+
+		parallel_for(c, [&](size_t j) {
+			rank_::graded g{ x + j, p.data() + j, c };
+			size_t m = r;
+			while (m > 0 && std::isnan(g[m - 1])) {
+				--m;
+				y[(size_t)g.p[m * c] * c + j] = NAN;
+			}
+			rank_::ranks(g, m, 0, m, 0, y + j, method);
+		}, std::max<size_t>(1, grade_block / 4 / std::max<size_t>(r, 1)));
+	}
+
+	// One plus the number of values of x less than v given its grade p.
+	inline double rank(size_t n, const double* x, const double* p, double v)
+	{
+		if (std::isnan(v)) {
+			return NAN;
+		}
+
+		const double* i = std::lower_bound(p, p + graded_count(n, x, p), v, [x](double i, double v) {
+			return x[(size_t)i] < v;
+		});
+
+		return static_cast<double>(i - p + 1);
+	}
+
+	// Quantiles q[i] of x at probabilities p[i] given its grade g, NaN values are ignored.
+	inline void graded_quantile(size_t n, const double* x, const double* g, const double* p, size_t np, double* q)
+	{
+		size_t m = graded_count(n, x, g);
+
+		for (size_t i = 0; i < np; ++i) {
+			if (m == 0 || std::isnan(p[i])) {
+				q[i] = NAN;
+
+				continue;
+			}
+
+			double h = (m - 1) * std::clamp(p[i], 0., 1.);
+			size_t k = static_cast<size_t>(h);
+			double xk = x[(size_t)g[k]];
+			q[i] = k + 1 < m ? xk + (h - k) * (x[(size_t)g[k + 1]] - xk) : xk;
+		}
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int grade_test()
+	{
+		{
+			double x[] = { 3, 1, NAN, 2, 1 };
+			double p[5];
+			grade(5, x, p);
+			assert(p[0] == 1 && p[1] == 4 && p[2] == 3 && p[3] == 0 && p[4] == 2);
+			assert(4 == graded_count(5, x, p));
+
+			double r[5];
+			rank(5, x, p, r);
+			assert(r[0] == 4 && r[1] == 1 && std::isnan(r[2]) && r[3] == 3 && r[4] == 1);
+
+			rank(5, x, p, r, rank_method::average);
+			assert(r[0] == 4 && r[1] == 1.5 && std::isnan(r[2]) && r[3] == 3 && r[4] == 1.5);
+			rank(5, x, p, r, rank_method::max);
+			assert(r[0] == 4 && r[1] == 2 && r[3] == 3 && r[4] == 2);
+			rank(5, x, p, r, rank_method::dense);
+			assert(r[0] == 3 && r[1] == 1 && r[3] == 2 && r[4] == 1);
+			rank(5, x, p, r, rank_method::ordinal);
+			assert(r[0] == 4 && r[1] == 1 && r[3] == 3 && r[4] == 2);
+
+			assert(1 == rank(5, x, p, 0.));
+			assert(1 == rank(5, x, p, 1.));
+			assert(3 == rank(5, x, p, 1.5));
+			assert(5 == rank(5, x, p, 4.));
+			assert(std::isnan(rank(5, x, p, NAN)));
+
+			double pr[] = { 0, 0.5, 1 };
+			double q[3];
+			graded_quantile(5, x, p, pr, 3, q);
+			assert(q[0] == 1 && q[1] == 1.5 && q[2] == 3);
+		}
+		{
+			double x[] = { 3, 1, 1, 0, NAN, 2 };
+			double p[6];
+			grade_rows(2, 3, x, p);
+			assert(p[0] == 1 && p[1] == 2 && p[2] == 0);
+			assert(p[3] == 0 && p[4] == 2 && p[5] == 1);
+			grade_columns(2, 3, x, p, true);
+			assert(p[0] == 0 && p[1] == 0 && p[2] == 1);
+			assert(p[3] == 1 && p[4] == 1 && p[5] == 0);
+		}
+		{
+			// columns
+			double x[] = { 2, 1, 2, NAN, 1, 0 };
+			double r[6];
+			rank_columns(3, 2, x, r, rank_method::average);
+			assert(r[0] == 2.5 && r[2] == 2.5 && r[4] == 1);
+			assert(r[1] == 2 && std::isnan(r[3]) && r[5] == 1);
+		}
+		{
+			// ties across scan chunks
+			size_t block = grade_block;
+			grade_block = 16;
+			size_t n = 1000;
+			std::vector<double> x(n), p(n), r(n);
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = double(i / 10);
+			}
+			grade(n, x.data(), p.data());
+			for (auto method : { rank_method::min, rank_method::average, rank_method::max, rank_method::dense, rank_method::ordinal }) {
+				rank(n, x.data(), p.data(), r.data(), method);
+				for (size_t i = 0; i < n; ++i) {
+					size_t lo = i / 10 * 10;
+					double ri = method == rank_method::min ? lo + 1.
+						: method == rank_method::average ? lo + 5.5
+						: method == rank_method::max ? lo + 10.
+						: method == rank_method::dense ? i / 10 + 1.
+						: i + 1.;
+					assert(r[i] == ri);
+				}
+			}
+			grade_block = block;
+		}
+		{
+			// several blocks and merge rounds
+			size_t block = grade_block;
+			grade_block = 16;
+			size_t n = 1003;
+			std::vector<double> x(n), p(n);
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = double((i * 7919) % 101);
+			}
+			grade(n, x.data(), p.data());
+			for (size_t i = 1; i < n; ++i) {
+				double a = x[(size_t)p[i - 1]], b = x[(size_t)p[i]];
+				assert(a < b || (a == b && p[i - 1] < p[i])); // stable
+			}
+			grade_block = block;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
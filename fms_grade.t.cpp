@@ -0,0 +1,6 @@
+// fms_grade.t.cpp - grade and rank tests
+#include "fms_grade.h"
+
+#ifdef _DEBUG
+int fms_grade_test = fms::grade_test();
+#endif // _DEBUG
@@ -0,0 +1,249 @@
+// fms_groupby.h - aggregate values by key
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+#include "fms_grade.h"
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char groupby_doc[] = R"xyzyx(
+<em>Group by</em> aggregates the values having the same key using a monoid.
+Keys are returned in increasing order. NaN keys are ignored.
+)xyzyx";
+
+	// number of rows aggregated by one task
+	inline size_t groupby_block = 1 << 16;
+
+	namespace groupby_ {
+
+		// Open addressing hash table from key to group index.
+		class table {
+			std::vector<double> key;
+			std::vector<size_t> group; // -1 if empty
+			size_t n = 0;
+
+			static uint64_t hash(double k)
+			{
+				uint64_t h = std::bit_cast<uint64_t>(k);
+				h ^= h >> 33;
+				h *= 0xff51afd7ed558ccdULL;
+				h ^= h >> 33;
+
+				return h;
+			}
+			void rehash()
+			{
+				std::vector<double> key_(std::max<size_t>(16, 2 * key.size()));
+				std::vector<size_t> group_(key_.size(), size_t(-1));
+				std::swap(key, key_);
+				std::swap(group, group_);
+				for (size_t i = 0; i < key_.size(); ++i) {
+					if (group_[i] != size_t(-1)) {
+						size_t j = slot(key_[i]);
+						key[j] = key_[i];
+						group[j] = group_[i];
+					}
+				}
+			}
+			size_t slot(double k) const
+			{
+				size_t mask = key.size() - 1;
+				size_t j = hash(k) & mask;
+				while (group[j] != size_t(-1) && key[j] != k) {
+					j = (j + 1) & mask;
+				}
+
+				return j;
+			}
+		public:
+			table()
+			{
+				rehash();
+			}
+			size_t size() const
+			{
+				return n;
+			}
+			// Return group of k, adding a new group if not found.
+			size_t operator[](double k)
+			{
+				size_t j = slot(k);
+				if (group[j] == size_t(-1)) {
+					if (2 * (n + 1) > key.size()) {
+						rehash();
+						j = slot(k);
+					}
+					key[j] = k;
+					group[j] = n++;
+				}
+
+				return group[j];
+			}
+		};
+
+		// Keys and aggregates of rows [b, e).
+		struct partial {
+			std::vector<double> key;
+			std::vector<double> agg; // key.size() x c
+		};
+
+		template<class Op>
+		inline partial hash(size_t b, size_t e, const double* key, size_t c, const double* value, double id, Op op)
+		{
+			partial p;
+			table t;
+
+			for (size_t i = b; i < e; ++i) {
+				if (!std::isnan(key[i])) {
+					double k = key[i] + 0.; // -0 is 0
+					size_t g = t[k];
+					if (g == p.key.size()) {
+						p.key.push_back(k);
+						p.agg.resize(p.agg.size() + c, id);
+					}
+					for (size_t j = 0; j < c; ++j) {
+						p.agg[g * c + j] = op(p.agg[g * c + j], value[i * c + j]);
+					}
+				}
+			}
+
+			return p;
+		}
+	}
+
+	// Aggregate rows of the n x c array value having the same key using the monoid (id, op).
+	// Return the sorted distinct keys and the k x c aggregates.
+	// Low cardinality keys are aggregated in parallel hash tables merged in order,
+	// high cardinality keys are sorted and runs aggregated.
+	template<class Op>
+	inline void groupby(size_t n, const double* key, size_t c, const double* value, double id, Op op,
+		std::vector<double>& keys, std::vector<double>& aggs)
+	{
+		keys.clear();
+		aggs.clear();
+
+		// estimate cardinality from a sample
+		const size_t ns = std::min<size_t>(n, 4096);
+		groupby_::table sample;
+		for (size_t i = 0; i < ns; ++i) {
+			sample[key[(i * n) / ns] + 0.];
+		}
+
+		if (2 * sample.size() > ns) {
+			// stable so non-commutative monoids see rows in order, NaN keys are last
+			pool_vector<double> idx(n);
+			grade(n, key, idx.data());
+			size_t m = n;
+			while (m > 0 && std::isnan(key[(size_t)idx[m - 1]])) {
+				--m;
+			}
+
+			for (size_t i = 0; i < m; ) {
+				double k = key[(size_t)idx[i]] + 0.;
+				size_t g = aggs.size();
+				keys.push_back(k);
+				aggs.resize(g + c, id);
+				for (; i < m && key[(size_t)idx[i]] == k; ++i) {
+					for (size_t j = 0; j < c; ++j) {
+						aggs[g + j] = op(aggs[g + j], value[(size_t)idx[i] * c + j]);
+					}
+				}
+			}
+
+			return;
+		}
+
+		const size_t b = std::max<size_t>(1, groupby_block / std::max<size_t>(c, 1));
+		const size_t nb = (n + b - 1) / b;
+		std::vector<groupby_::partial> part(nb);
+		parallel_for(nb, [&](size_t i) {
+			part[i] = groupby_::hash(i * b, std::min(n, (i + 1) * b), key, c, value, id, op);
+		});
+
+		// merge partial aggregates in row order
+		groupby_::table t;
+		std::vector<double> key_, agg_;
+		for (const auto& p : part) {
+			for (size_t g = 0; g < p.key.size(); ++g) {
+				size_t h = t[p.key[g]];
+				if (h == key_.size()) {
+					key_.push_back(p.key[g]);
+					agg_.resize(agg_.size() + c, id);
+				}
+				for (size_t j = 0; j < c; ++j) {
+					agg_[h * c + j] = op(agg_[h * c + j], p.agg[g * c + j]);
+				}
+			}
+		}
+
+		std::vector<size_t> order(key_.size());
+		std::iota(order.begin(), order.end(), size_t(0));
+		std::sort(order.begin(), order.end(), [&key_](size_t i, size_t j) { return key_[i] < key_[j]; });
+		keys.reserve(order.size());
+		aggs.reserve(order.size() * c);
+		for (size_t g : order) {
+			keys.push_back(key_[g]);
+			aggs.insert(aggs.end(), agg_.begin() + g * c, agg_.begin() + (g + 1) * c);
+		}
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int groupby_test()
+	{
+		{
+			double k[] = { 2, 1, 2, NAN, -0., 1, 0 };
+			double v[] = { 1, 2, 3, 4, 5, 6, 7 };
+			std::vector<double> keys, aggs;
+			groupby(7, k, 1, v, 0., std::plus<double>{}, keys, aggs);
+			assert(keys == std::vector<double>({ 0, 1, 2 }));
+			assert(aggs == std::vector<double>({ 12, 8, 4 }));
+		}
+		{
+			// both strategies and several blocks
+			size_t block = groupby_block, gblock = grade_block;
+			groupby_block = 100;
+			grade_block = 1000;
+			for (size_t m : { 3, 5000 }) {
+				size_t n = 10000;
+				std::vector<double> k(n), v(2 * n), keys, aggs;
+				for (size_t i = 0; i < n; ++i) {
+					k[i] = double((i * 7919) % m);
+					v[2 * i] = 1;
+					v[2 * i + 1] = double(i);
+				}
+				groupby(n, k.data(), 2, v.data(), 0., std::plus<double>{}, keys, aggs);
+				assert(keys.size() == m);
+				assert(aggs.size() == 2 * m);
+				assert(std::is_sorted(keys.begin(), keys.end()));
+				double count = 0;
+				for (size_t g = 0; g < m; ++g) {
+					count += aggs[2 * g];
+				}
+				assert(count == n);
+
+				groupby(n, k.data(), 2, v.data(), -HUGE_VAL, [](double x, double y) { return std::max(x, y); }, keys, aggs);
+				for (size_t g = 0; g < m; ++g) {
+					size_t i = n - 1;
+					while ((i * 7919) % m != g) {
+						--i;
+					}
+					assert(keys[g] == double(g));
+					assert(aggs[2 * g + 1] == double(i));
+				}
+			}
+			groupby_block = block;
+			grade_block = gblock;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_groupby.t.cpp - group by tests
+#include "fms_groupby.h"
+
+#ifdef _DEBUG
+int fms_groupby_test = fms::groupby_test();
+#endif // _DEBUG
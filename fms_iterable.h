@@ -852,6 +852,96 @@ namespace fms::iterable {
 		return concatenate2(i, concatenate(is...));
 	}
 
+	// merge2(i, j) is the stable merge of increasing i and j
+
+	// min(*i, *j), ... taking from i on ties
+	template<iterable I, iterable J>
+	class merge2 {
+		I i;
+		J j;
+
+		constexpr bool left() const
+		{
+			return i and (!j or !(*j < *i));
+		}
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using difference_type = std::common_type_t<typename I::difference_type, typename J::difference_type>;
+		using value_type = std::common_type_t<typename I::value_type, typename J::value_type>;
+		using reference = value_type;
+		using pointer = std::common_type_t<typename I::pointer, typename J::pointer>;
+
+		constexpr merge2() = default;
+		constexpr merge2(const I& i, const J& j)
+			: i(i), j(j)
+		{ }
+
+		bool operator==(const merge2&) const = default;
+
+		constexpr auto begin() const
+		{
+			return *this;
+		}
+		constexpr auto end() const
+		{
+			return merge2(i.end(), j.end());
+		}
+
+		constexpr explicit operator bool() const
+		{
+			return i or j;
+		}
+		constexpr value_type operator*() const
+		{
+			return left() ? *i : *j;
+		}
+		constexpr merge2& operator++()
+		{
+			if (left()) {
+				++i;
+			}
+			else if (j) {
+				++j;
+			}
+
+			return *this;
+		}
+		constexpr merge2 operator++(int)
+		{
+			merge2 m(*this);
+			operator++();
+
+			return m;
+		}
+	};
+
+	template<iterable I>
+	constexpr auto merge(I i)
+	{
+		return i;
+	}
+	template<iterable I, iterable ...Is>
+	constexpr auto merge(I i, Is... is)
+	{
+		return merge2(i, merge(is...));
+	}
+
+#ifdef _DEBUG
+	namespace test {
+		static_assert([]() {
+			int a[] = { 1, 3, 5 }, b[] = { 2, 3, 4, 6 }, c[] = { 0, 7 };
+			auto m = merge(take(3, ptr(a)), take(4, ptr(b)), take(2, ptr(c)));
+			int z[] = { 0, 1, 2, 3, 3, 4, 5, 6, 7 };
+			for (int k : z) {
+				if (!m || *m != k) return false;
+				++m;
+			}
+
+			return !m;
+		}());
+	}
+#endif // _DEBUG
+
 
 	// t, ++t, ...
 	template<class T>
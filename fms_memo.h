@@ -0,0 +1,237 @@
+// fms_memo.h - versioned memoization cache
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace fms {
+
+	inline const char memo_doc[] = R"xyzyx(
+A <em>memo</em> caches results of pure functions keyed by the function name,
+its arguments, and the versions of its inputs. Every mutation of an input
+bumps its version so stale results are never found. The least recently
+used results are evicted when the cache exceeds its memory budget.
+)xyzyx";
+
+	// Version counters of mutable objects identified by address.
+	class versions {
+		std::mutex m;
+		std::unordered_map<const void*, uint64_t> v;
+		uint64_t next = 0;
+		size_t swept = 64; // size of v that triggers the next sweep
+	public:
+		static versions& instance()
+		{
+			static versions* v = new versions();
+
+			return *v;
+		}
+
+		// current version of p, assigning a new one if p has not been seen
+		uint64_t get(const void* p)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			auto i = v.find(p);
+
+			return i != v.end() ? i->second : (v[p] = ++next);
+		}
+		// give p a new version
+		uint64_t bump(const void* p)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			return v[p] = ++next;
+		}
+		// forget p, it gets a new version if seen again
+		void erase(const void* p)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			v.erase(p);
+		}
+		// forget every p with dead(p) once the table has doubled since the last sweep
+		template<class Dead>
+		void sweep(Dead dead)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			if (v.size() < swept) {
+				return;
+			}
+			std::erase_if(v, [&dead](const auto& pv) { return dead(pv.first); });
+			swept = std::max<size_t>(64, 2 * v.size());
+		}
+		size_t size()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			return v.size();
+		}
+	};
+
+	// Cache key from a function name and numeric arguments.
+	inline std::string memo_key(const char* fn, std::initializer_list<double> args)
+	{
+		std::string key(fn);
+
+		key.push_back(0);
+		for (double a : args) {
+			key.append(reinterpret_cast<const char*>(&a), sizeof(double));
+		}
+
+		return key;
+	}
+
+	template<class V>
+	class memo {
+		struct entry {
+			std::string key;
+			std::shared_ptr<const V> value;
+			size_t bytes;
+		};
+		std::mutex m;
+		std::list<entry> lru; // most recently used first
+		std::unordered_map<std::string, typename std::list<entry>::iterator> index;
+		size_t budget_, bytes_ = 0;
+		std::atomic<size_t> hits_ = 0, misses_ = 0;
+
+		void evict()
+		{
+			while (bytes_ > budget_ && !lru.empty()) {
+				bytes_ -= lru.back().bytes;
+				index.erase(lru.back().key);
+				lru.pop_back();
+			}
+		}
+	public:
+		struct statistics {
+			size_t hits;
+			size_t misses;
+			size_t entries;
+			size_t bytes;
+		};
+
+		memo(size_t budget)
+			: budget_(budget)
+		{ }
+
+		// cached value or nullptr
+		std::shared_ptr<const V> find(const std::string& key)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			auto i = index.find(key);
+			if (i == index.end()) {
+				++misses_;
+
+				return nullptr;
+			}
+			++hits_;
+			lru.splice(lru.begin(), lru, i->second);
+
+			return i->second->value;
+		}
+		// cache value using bytes of the budget
+		void insert(const std::string& key, std::shared_ptr<const V> value, size_t bytes)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			auto i = index.find(key);
+			if (i != index.end()) {
+				bytes_ -= i->second->bytes;
+				lru.erase(i->second);
+				index.erase(i);
+			}
+			if (bytes > budget_) {
+				return;
+			}
+			lru.push_front(entry{ key, value, bytes });
+			index[key] = lru.begin();
+			bytes_ += bytes;
+			evict();
+		}
+
+		void budget(size_t b)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			budget_ = b;
+			evict();
+		}
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			lru.clear();
+			index.clear();
+			bytes_ = 0;
+		}
+
+		statistics stats()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			return statistics{ hits_, misses_, index.size(), bytes_ };
+		}
+	};
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int memo_test()
+	{
+		{
+			versions v;
+			int a, b;
+			uint64_t va = v.get(&a);
+			assert(v.get(&a) == va);
+			assert(v.get(&b) != va);
+			assert(v.bump(&a) != va);
+			assert(v.get(&a) != va);
+			v.erase(&a);
+			assert(v.size() == 1);
+			assert(v.get(&a) > v.get(&b));
+
+			int c[100];
+			for (int& ci : c) {
+				v.get(&ci);
+			}
+			v.sweep([&](const void* p) { return p != &a && p != &b && p != c; });
+			assert(v.size() == 3);
+		}
+		{
+			assert(memo_key("f", { 1, 2 }) != memo_key("f", { 1, 3 }));
+			assert(memo_key("f", { 1 }) != memo_key("g", { 1 }));
+		}
+		{
+			memo<int> m(10);
+			assert(!m.find("a"));
+			m.insert("a", std::make_shared<int>(1), 4);
+			m.insert("b", std::make_shared<int>(2), 4);
+			assert(*m.find("a") == 1);
+			// b is least recently used
+			m.insert("c", std::make_shared<int>(3), 4);
+			assert(!m.find("b"));
+			assert(*m.find("a") == 1 && *m.find("c") == 3);
+			m.insert("d", std::make_shared<int>(4), 11); // over budget
+			assert(!m.find("d"));
+			auto s = m.stats();
+			assert(s.entries == 2 && s.bytes == 8);
+			assert(s.hits == 3 && s.misses == 3);
+			m.clear();
+			assert(m.stats().entries == 0);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
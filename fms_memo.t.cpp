@@ -0,0 +1,6 @@
+// fms_memo.t.cpp - memoization tests
+#include "fms_memo.h"
+
+#ifdef _DEBUG
+int fms_memo_test = fms::memo_test();
+#endif // _DEBUG
@@ -0,0 +1,250 @@
+// fms_merge.h - k-way merge of sorted arrays
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <vector>
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char merge_doc[] = R"xyzyx(
+A <em>k-way merge</em> combines k increasing arrays into one increasing array
+in a single pass. A <em>loser tree</em> holds the current item of each array
+and finds the next smallest item with \(\log_2 k\) comparisons.
+Ties are taken from the earlier array so the merge is stable.
+Large merges are split into parts at common values and the parts are merged in parallel.
+)xyzyx";
+
+	// number of output items merged by one task
+	inline size_t merge_block = 1 << 16;
+
+	// Tournament tree of the current items of k increasing arrays.
+	class loser_tree {
+		size_t k; // number of leaves, a power of 2
+		std::vector<const double*> cur, end;
+		std::vector<size_t> loser; // loser[0] is the winner
+
+		// leaf a comes before leaf b
+		bool beats(size_t a, size_t b) const
+		{
+			if (cur[a] == end[a]) {
+				return false;
+			}
+			if (cur[b] == end[b]) {
+				return true;
+			}
+
+			return *cur[a] < *cur[b] || (!(*cur[b] < *cur[a]) && a < b);
+		}
+		size_t init(size_t node)
+		{
+			if (node >= k) {
+				return node - k;
+			}
+
+			size_t l = init(2 * node), r = init(2 * node + 1);
+			if (beats(l, r)) {
+				loser[node] = r;
+
+				return l;
+			}
+			loser[node] = l;
+
+			return r;
+		}
+	public:
+		// Arrays [b[i], e[i]) for i < n.
+		loser_tree(size_t n, const double* const* b, const double* const* e)
+			: k(std::bit_ceil(std::max<size_t>(n, 1))), cur(k), end(k), loser(k)
+		{
+			std::copy(b, b + n, cur.begin());
+			std::copy(e, e + n, end.begin());
+			loser[0] = init(1);
+		}
+
+		explicit operator bool() const
+		{
+			return cur[loser[0]] != end[loser[0]];
+		}
+		double operator*() const
+		{
+			return *cur[loser[0]];
+		}
+		// advance the winner and replay its path to the root
+		loser_tree& operator++()
+		{
+			size_t w = loser[0];
+			++cur[w];
+			for (size_t node = (w + k) / 2; node > 0; node /= 2) {
+				if (beats(loser[node], w)) {
+					std::swap(loser[node], w);
+				}
+			}
+			loser[0] = w;
+
+			return *this;
+		}
+	};
+
+	namespace merge_ {
+
+		// Merge into y dropping items equal to the previous item if unique. Return the number written.
+		inline size_t block(size_t k, const double* const* b, const double* const* e, double* y, bool unique)
+		{
+			size_t m = 0;
+
+			for (loser_tree t(k, b, e); t; ++t) {
+				double x = *t;
+				if (!unique || m == 0 || y[m - 1] != x) {
+					y[m++] = x;
+				}
+			}
+
+			return m;
+		}
+
+		// Splitters at regular positions of the sorted sample of all arrays.
+		inline std::vector<double> splitters(size_t k, const double* const* x, const size_t* n, size_t parts)
+		{
+			size_t N = 0;
+			for (size_t i = 0; i < k; ++i) {
+				N += n[i];
+			}
+			const size_t step = std::max<size_t>(1, N / (8 * parts));
+
+			std::vector<double> s;
+			for (size_t i = 0; i < k; ++i) {
+				for (size_t j = step / 2; j < n[i]; j += step) {
+					s.push_back(x[i][j]);
+				}
+			}
+			std::sort(s.begin(), s.end());
+
+			std::vector<double> v;
+			for (size_t p = 1; p < parts && !s.empty(); ++p) {
+				double vp = s[p * s.size() / parts];
+				if (v.empty() || v.back() < vp) {
+					v.push_back(vp);
+				}
+			}
+
+			return v;
+		}
+	}
+
+	// Merge k increasing arrays x[i] of size n[i] into y, dropping duplicates if unique.
+	// Return the number of items written to y.
+	inline size_t merge(size_t k, const double* const* x, const size_t* n, double* y, bool unique = false)
+	{
+		size_t N = 0;
+		for (size_t i = 0; i < k; ++i) {
+			N += n[i];
+		}
+
+		std::vector<const double*> e(k);
+		for (size_t i = 0; i < k; ++i) {
+			e[i] = x[i] + n[i];
+		}
+		if (N <= 2 * merge_block) {
+			return merge_::block(k, x, e.data(), y, unique);
+		}
+
+		// part p is all items in [v[p - 1], v[p]) so equal items are never split
+		std::vector<double> v = merge_::splitters(k, x, n, (N + merge_block - 1) / merge_block);
+		const size_t np = v.size() + 1;
+		std::vector<const double*> cut((np + 1) * k);
+		std::vector<size_t> off(np + 1), count(np);
+		for (size_t i = 0; i < k; ++i) {
+			cut[i] = x[i];
+			for (size_t p = 1; p < np; ++p) {
+				cut[p * k + i] = std::lower_bound(x[i], e[i], v[p - 1]);
+			}
+			cut[np * k + i] = e[i];
+		}
+		for (size_t p = 0; p < np; ++p) {
+			off[p + 1] = off[p];
+			for (size_t i = 0; i < k; ++i) {
+				off[p + 1] += cut[(p + 1) * k + i] - cut[p * k + i];
+			}
+		}
+
+		parallel_for(np, [&](size_t p) {
+			count[p] = merge_::block(k, cut.data() + p * k, cut.data() + (p + 1) * k, y + off[p], unique);
+		});
+
+		// move parts down over dropped duplicates
+		size_t m = count[0];
+		for (size_t p = 1; p < np; ++p) {
+			if (m != off[p]) {
+				std::memmove(y + m, y + off[p], count[p] * sizeof(double));
+			}
+			m += count[p];
+		}
+
+		return m;
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int merge_test()
+	{
+		{
+			double a[] = { 1, 3, 5 }, b[] = { 2, 3, 4, 6 }, c[] = { 0, 7 };
+			const double* x[] = { a, b, c };
+			size_t n[] = { 3, 4, 2 };
+			double y[9];
+			assert(9 == merge(3, x, n, y));
+			double z[] = { 0, 1, 2, 3, 3, 4, 5, 6, 7 };
+			assert(std::equal(y, y + 9, z));
+			assert(8 == merge(3, x, n, y, true));
+			assert(y[3] == 3 && y[4] == 4);
+		}
+		{
+			// empty and single arrays
+			double a[] = { 1, 2 };
+			const double* x[] = { a, a };
+			size_t n[] = { 0, 2 };
+			double y[2];
+			assert(2 == merge(2, x, n, y));
+			assert(y[0] == 1 && y[1] == 2);
+			assert(0 == merge(1, x, n, y));
+		}
+		{
+			// parallel parts agree with one block
+			size_t block = merge_block;
+			for (size_t k : { 2, 5, 16 }) {
+				std::vector<std::vector<double>> xs(k);
+				std::vector<const double*> x(k);
+				std::vector<size_t> n(k);
+				size_t N = 0;
+				for (size_t i = 0; i < k; ++i) {
+					for (size_t j = 0; j < 100 + 37 * i; ++j) {
+						xs[i].push_back(double((j * (i + 3)) / 4));
+					}
+					x[i] = xs[i].data();
+					n[i] = xs[i].size();
+					N += n[i];
+				}
+				for (bool unique : { false, true }) {
+					std::vector<double> y(N), z(N);
+					merge_block = N;
+					size_t m = merge(k, x.data(), n.data(), y.data(), unique);
+					merge_block = 16;
+					assert(m == merge(k, x.data(), n.data(), z.data(), unique));
+					assert(std::equal(y.begin(), y.begin() + m, z.begin()));
+					assert(std::is_sorted(y.begin(), y.begin() + m));
+					if (unique) {
+						assert(std::adjacent_find(y.begin(), y.begin() + m) == y.begin() + m);
+					}
+				}
+			}
+			merge_block = block;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_merge.t.cpp - k-way merge tests
+#include "fms_merge.h"
+
+#ifdef _DEBUG
+int fms_merge_test = fms::merge_test();
+#endif // _DEBUG
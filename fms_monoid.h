@@ -46,16 +46,29 @@ that is associative and has an identity.
 	};
 	
 	template<class X>
-	constexpr auto monoid_add = _monoid<X>(nullop_zero<X>, binop_add<X>);
+	inline constexpr auto monoid_add = _monoid<X>(nullop_zero<X>, binop_add<X>);
 
 	template<class X>
-	constexpr auto monoid_mul = _monoid<X>(nullop_one<X>, binop_mul<X>);
+	inline constexpr auto monoid_mul = _monoid<X>(nullop_one<X>, binop_mul<X>);
 	
 	template<class X>
-	constexpr auto monoid_max = _monoid<X>(nullop_max<X>, binop_max<X>);
+	inline constexpr auto monoid_max = _monoid<X>(nullop_max<X>, binop_max<X>);
 	
 	template<class X>
-	constexpr auto monoid_min = _monoid<X>(nullop_min<X>, binop_min<X>);
+	inline constexpr auto monoid_min = _monoid<X>(nullop_min<X>, binop_min<X>);
+
+	// Call f with the identity and a function object equivalent to the operation of m.
+	// Predefined monoids are passed as function objects so they can be inlined.
+	template<class X, class F>
+	inline auto visit(const monoid<X>& m, F f) -> decltype(f(X{}, std::plus<X>{}))
+	{
+		if (&m == &monoid_add<X>) return f(X(0), std::plus<X>{});
+		if (&m == &monoid_mul<X>) return f(X(1), std::multiplies<X>{});
+		if (&m == &monoid_max<X>) return f(m(), [](const X& x, const X& y) { return std::max(x, y); });
+		if (&m == &monoid_min<X>) return f(m(), [](const X& x, const X& y) { return std::min(x, y); });
+
+		return f(m(), [&m](const X& x, const X& y) { return m(x, y); });
+	}
 
 	template<class X>
 	inline X fold(const monoid<X>& m)
@@ -123,6 +136,13 @@ that is associative and has an identity.
 			assert(fold<X>(monoid_add<X>, 1, 2) == 1 + 2);
 			assert(fold<X>(monoid_add<X>, 1, 2, 3) == 1 + 2 + 3);
 		}
+		{
+			auto f = [](X id, auto op) { return op(op(id, X(2)), X(3)); };
+			assert(visit(monoid_add<X>, f) == 5);
+			assert(visit(monoid_mul<X>, f) == 6);
+			assert(visit(monoid_max<X>, f) == 3);
+			assert(visit(monoid_min<X>, f) == 2);
+		}
 		{
 			assert(fold<X>(monoid_mul<X>) == 1);
 			assert(fold<X>(monoid_mul<X>, 1) == 1);
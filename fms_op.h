@@ -136,6 +136,27 @@ namespace fms {
 
 #undef MAKE_BINOP
 
+	// Call f with a function object equivalent to op.
+	// Predefined operators are passed as standard function objects so they can be inlined.
+	template<class X, class F>
+	inline auto visit(const binop<X>& op, F f) -> decltype(f(std::plus<X>{}))
+	{
+		if (&op == &binop_add<X>) return f(std::plus<X>{});
+		if (&op == &binop_sub<X>) return f(std::minus<X>{});
+		if (&op == &binop_mul<X>) return f(std::multiplies<X>{});
+		if (&op == &binop_div<X>) return f(std::divides<X>{});
+		if (&op == &binop_logical_or<X>) return f(std::logical_or<X>{});
+		if (&op == &binop_logical_and<X>) return f(std::logical_and<X>{});
+		if (&op == &binop_lt<X>) return f(std::less<X>{});
+		if (&op == &binop_le<X>) return f(std::less_equal<X>{});
+		if (&op == &binop_gt<X>) return f(std::greater<X>{});
+		if (&op == &binop_ge<X>) return f(std::greater_equal<X>{});
+		if (&op == &binop_eq<X>) return f(std::equal_to<X>{});
+		if (&op == &binop_ne<X>) return f(std::not_equal_to<X>{});
+
+		return f([&op](const X& x, const X& y) { return op(x, y); });
+	}
+
 	/*
 	template <typename ... Args>
 	auto f(Args&& ... args) {
@@ -183,10 +204,16 @@ namespace fms {
 
 			assert(binop_max<X>(x, y) == ((x > y) ? x : y));
 		}
+		{
+			X x(2), y(1);
+
+			assert(visit(binop_lt<X>, [x, y](auto op) { return op(x, y); }) == (x < y));
+			assert(visit(binop_max<X>, [x, y](auto op) { return op(x, y); }) == x);
+		}
 
 		return 0;
 	}
 
 #endif // _DEBUG
 
-}
\ No newline at end of file
+}
\ No newline at end of file
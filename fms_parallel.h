@@ -0,0 +1,397 @@
+// fms_parallel.h - shared work-stealing scheduler
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace fms {
+
+	inline const char parallel_doc[] = R"xyzyx(
+Array kernels share one process-wide pool of worker threads.
+Each worker has a deque of tasks. Workers pop their newest task and
+steal the oldest task from other workers when their own deque is empty.
+A thread waiting for a parallel loop runs queued tasks until the loop
+is done, so loops can be nested and called from any thread.
+)xyzyx";
+
+	// number of chunks per worker a loop is split into for load balancing
+	inline size_t parallel_split = 4;
+
+	class scheduler {
+		struct job {
+			std::atomic<size_t> pending;
+			std::exception_ptr ex;
+			std::mutex m;
+		};
+		struct task {
+			void (*run)(const void*, size_t, size_t);
+			const void* f;
+			size_t b, e;
+			job* j;
+		};
+		struct worker {
+			std::mutex m;
+			std::deque<task> q;
+		};
+
+		std::vector<std::unique_ptr<worker>> workers;
+		std::vector<std::thread> threads;
+		std::atomic<size_t> queued = 0;
+		std::atomic<size_t> next = 0; // home of external threads
+		std::atomic<bool> stop = false;
+		std::atomic<bool> running = false;
+		std::mutex life; // start and shutdown
+		std::mutex m;
+		std::condition_variable cv;
+
+		// worker thread index and its scheduler
+		static inline thread_local size_t self = 0;
+		static inline thread_local const scheduler* owner = nullptr;
+
+		static void execute(const task& t)
+		{
+			try {
+				t.run(t.f, t.b, t.e);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(t.j->m);
+				if (!t.j->ex) {
+					t.j->ex = std::current_exception();
+				}
+			}
+			t.j->pending.fetch_sub(1, std::memory_order_release);
+		}
+
+		void push(size_t home, const task& t)
+		{
+			{
+				std::lock_guard<std::mutex> lock(workers[home]->m);
+				workers[home]->q.push_back(t);
+			}
+			++queued;
+		}
+
+		// pop the newest task from home or steal the oldest from another worker
+		bool try_run(size_t home)
+		{
+			if (queued.load(std::memory_order_acquire) == 0) {
+				return false;
+			}
+
+			const size_t n = workers.size();
+			for (size_t k = 0; k < n; ++k) {
+				worker& w = *workers[(home + k) % n];
+				task t;
+				{
+					std::lock_guard<std::mutex> lock(w.m);
+					if (w.q.empty()) {
+						continue;
+					}
+					if (k == 0) {
+						t = w.q.back();
+						w.q.pop_back();
+					}
+					else {
+						t = w.q.front();
+						w.q.pop_front();
+					}
+				}
+				--queued;
+				execute(t);
+
+				return true;
+			}
+
+			return false;
+		}
+
+		void loop(size_t id)
+		{
+			self = id;
+			owner = this;
+			while (!stop) {
+				if (!try_run(id)) {
+					std::unique_lock<std::mutex> lock(m);
+					cv.wait_for(lock, std::chrono::milliseconds(1), [this] { return stop || queued > 0; });
+				}
+			}
+		}
+
+		template<class F>
+		static void run(const void* f, size_t b, size_t e)
+		{
+			const F& f_ = *static_cast<const F*>(f);
+			for (size_t i = b; i < e; ++i) {
+				f_(i);
+			}
+		}
+	public:
+		explicit scheduler(size_t n = std::max(1u, std::thread::hardware_concurrency()))
+		{
+			for (size_t i = 0; i < n; ++i) {
+				workers.emplace_back(std::make_unique<worker>());
+			}
+			start();
+		}
+		scheduler(const scheduler&) = delete;
+		scheduler& operator=(const scheduler&) = delete;
+		~scheduler()
+		{
+			shutdown();
+		}
+
+		// Start the worker threads if they are not running.
+		void start()
+		{
+			std::lock_guard<std::mutex> lock(life);
+			if (running) {
+				return;
+			}
+			stop = false;
+			// the calling thread also runs tasks so one fewer thread is started
+			for (size_t i = 1; i < workers.size(); ++i) {
+				threads.emplace_back(&scheduler::loop, this, i);
+			}
+			running = true;
+		}
+		// Stop and join the worker threads. The next loop starts them again.
+		// Tasks left queued are run by the threads waiting for them.
+		void shutdown()
+		{
+			std::lock_guard<std::mutex> lock(life);
+			stop = true;
+			cv.notify_all();
+			for (auto& t : threads) {
+				t.join();
+			}
+			threads.clear();
+			running = false;
+		}
+
+		// never destroyed so workers outlive static objects
+		static scheduler& instance()
+		{
+			static scheduler* s = new scheduler();
+
+			return *s;
+		}
+
+		size_t size() const
+		{
+			return workers.size();
+		}
+
+		// number of items in each chunk of a loop over n items
+		size_t chunk(size_t n, size_t grain = 1) const
+		{
+			return std::max(std::max<size_t>(grain, 1), (n + parallel_split * size() - 1) / (parallel_split * size()));
+		}
+
+		// Call f(i) for i in [0, n) in chunks of at least grain items.
+		template<class F>
+		void for_each(size_t n, const F& f, size_t grain = 1)
+		{
+			const size_t c = chunk(n, grain);
+			const size_t nc = n ? (n + c - 1) / c : 0;
+
+			if (nc <= 1 || size() == 1) {
+				run<F>(&f, 0, n);
+
+				return;
+			}
+			if (!running) {
+				start();
+			}
+
+			const size_t home = owner == this ? self : next++ % size();
+			job j;
+			j.pending = nc;
+			for (size_t k = nc; k-- > 1; ) {
+				push(home, task{ &run<F>, &f, k * c, std::min(n, (k + 1) * c), &j });
+			}
+			cv.notify_all();
+
+			execute(task{ &run<F>, &f, 0, c, &j });
+			while (j.pending.load(std::memory_order_acquire) > 0) {
+				if (!try_run(home)) {
+					std::this_thread::yield();
+				}
+			}
+
+			if (j.ex) {
+				std::rethrow_exception(j.ex);
+			}
+		}
+	};
+
+	// Call f(i) for i in [0, n) on the shared scheduler.
+	template<class F>
+	inline void parallel_for(size_t n, const F& f, size_t grain = 1)
+	{
+		scheduler::instance().for_each(n, f, grain);
+	}
+
+	// Return op(... op(op(id, f(b0, e0)), f(b1, e1)) ...) over chunks [b, e) of [0, n) in order.
+	template<class T, class F, class Op>
+	inline T parallel_reduce(size_t n, T id, const F& f, const Op& op, size_t grain = 1)
+	{
+		const size_t c = scheduler::instance().chunk(n, grain);
+		const size_t nc = (n + c - 1) / c;
+		std::vector<T> part(nc, id);
+
+		parallel_for(nc, [&](size_t k) {
+			part[k] = f(k * c, std::min(n, (k + 1) * c));
+		});
+
+		T t = id;
+		for (const auto& p : part) {
+			t = op(t, p);
+		}
+
+		return t;
+	}
+
+	// Call scan(b, e, t) for chunks [b, e) of [0, n) where t is the reduction of all previous chunks.
+	// Chunks are reduced in parallel, the prefixes computed in order, then chunks are scanned in parallel.
+	template<class T, class R, class Op, class S>
+	inline void parallel_scan(size_t n, T id, const R& reduce, const Op& op, const S& scan, size_t grain = 1)
+	{
+		const size_t c = scheduler::instance().chunk(n, grain);
+		const size_t nc = (n + c - 1) / c;
+		std::vector<T> part(nc, id);
+
+		parallel_for(nc, [&](size_t k) {
+			if (k + 1 < nc) { // last chunk is not needed
+				part[k] = reduce(k * c, std::min(n, (k + 1) * c));
+			}
+		});
+
+		T t = id;
+		for (auto& p : part) {
+			T p_ = p;
+			p = t;
+			t = op(t, p_);
+		}
+
+		parallel_for(nc, [&](size_t k) {
+			scan(k * c, std::min(n, (k + 1) * c), part[k]);
+		});
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int parallel_test()
+	{
+		{
+			// loops run and restart the workers after shutdown
+			scheduler s(4);
+			s.shutdown();
+			std::vector<size_t> x(1000);
+			s.for_each(x.size(), [&](size_t i) { x[i] = i; });
+			assert(x[999] == 999);
+			s.shutdown();
+		}
+		scheduler sched(4);
+		{
+			size_t n = 100000;
+			std::vector<size_t> x(n);
+			sched.for_each(n, [&](size_t i) { x[i] = i; });
+			for (size_t i = 0; i < n; ++i) {
+				assert(x[i] == i);
+			}
+			parallel_for(n, [&](size_t i) { x[i] = n - i; });
+			for (size_t i = 0; i < n; ++i) {
+				assert(x[i] == n - i);
+			}
+		}
+		{
+			// nested loops
+			std::atomic<size_t> s = 0;
+			sched.for_each(64, [&](size_t) {
+				sched.for_each(64, [&](size_t j) { s += j; });
+				parallel_for(64, [&](size_t j) { s += j; });
+			});
+			assert(s == 2 * 64 * (63 * 64 / 2));
+		}
+		{
+			// calls from other threads
+			std::atomic<size_t> s = 0;
+			std::vector<std::thread> t;
+			for (int k = 0; k < 4; ++k) {
+				t.emplace_back([&] { sched.for_each(1000, [&](size_t i) { s += i; }); });
+			}
+			for (auto& tk : t) {
+				tk.join();
+			}
+			assert(s == 4 * (999 * 1000 / 2));
+		}
+		{
+			size_t n = 12345;
+			auto s = parallel_reduce(n, size_t(0), [](size_t b, size_t e) {
+				size_t s = 0;
+				for (size_t i = b; i < e; ++i) {
+					s += i;
+				}
+				return s;
+			}, std::plus<size_t>{});
+			assert(s == n * (n - 1) / 2);
+
+			// order is preserved
+			auto f = parallel_reduce(n, std::vector<size_t>{}, [](size_t b, size_t e) {
+				return std::vector<size_t>{ b, e };
+			}, [](std::vector<size_t> a, const std::vector<size_t>& b) {
+				a.insert(a.end(), b.begin(), b.end());
+				return a;
+			});
+			assert(f.front() == 0 && f.back() == n);
+			assert(std::is_sorted(f.begin(), f.end()));
+		}
+		{
+			size_t n = 10000;
+			std::vector<size_t> x(n, 1), y(n);
+			parallel_scan(n, size_t(0), [&](size_t b, size_t e) {
+				size_t s = 0;
+				for (size_t i = b; i < e; ++i) {
+					s += x[i];
+				}
+				return s;
+			}, std::plus<size_t>{}, [&](size_t b, size_t e, size_t s) {
+				for (size_t i = b; i < e; ++i) {
+					s += x[i];
+					y[i] = s;
+				}
+			});
+			for (size_t i = 0; i < n; ++i) {
+				assert(y[i] == i + 1);
+			}
+		}
+		{
+			bool thrown = false;
+			try {
+				sched.for_each(1000, [](size_t i) {
+					if (i == 999) {
+						throw std::runtime_error("parallel_test");
+					}
+				});
+			}
+			catch (const std::runtime_error&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_parallel.t.cpp - scheduler tests
+#include "fms_parallel.h"
+
+#ifdef _DEBUG
+int fms_parallel_test = fms::parallel_test();
+#endif // _DEBUG
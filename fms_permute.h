@@ -0,0 +1,161 @@
+// fms_permute.h - apply and invert permutations
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "fms_parallel.h"
+#include "fms_pool.h"
+
+namespace fms {
+
+	inline const char permute_doc[] = R"xyzyx(
+A <em>permutation</em> of n items is an array of the indices 0 to n - 1 in some order.
+Applying permutation p to x gives <code>y[i] = x[p[i]]</code> so applying the grade of
+an array sorts it. The inverse q of p has <code>q[p[i]] = i</code>.
+)xyzyx";
+
+	// number of items gathered by one task
+	inline size_t permute_block = 1 << 14;
+	// most doubles gathered through a buffer, larger arrays are permuted by following cycles
+	inline size_t permute_buffer = size_t(1) << 25;
+
+	namespace permute_ {
+
+		// Apply p to n items of width w by following cycles, marking visited items.
+		inline void cycles(double* x, size_t n, size_t w, const double* p)
+		{
+			std::vector<bool> visited(n);
+			std::vector<double> t(w);
+
+			for (size_t i = 0; i < n; ++i) {
+				if (visited[i]) {
+					continue;
+				}
+				visited[i] = true;
+				size_t k = (size_t)p[i];
+				if (k == i) {
+					continue;
+				}
+
+				std::memcpy(t.data(), x + i * w, w * sizeof(double));
+				size_t j = i;
+				while (k != i) {
+					std::memcpy(x + j * w, x + k * w, w * sizeof(double));
+					visited[k] = true;
+					j = k;
+					k = (size_t)p[j];
+				}
+				std::memcpy(x + j * w, t.data(), w * sizeof(double));
+			}
+		}
+
+		// Apply p to n items of width w by gathering blocks in parallel.
+		inline void gather(double* x, size_t n, size_t w, const double* p)
+		{
+			pool_vector<double> y(n * w);
+			const size_t b = std::max<size_t>(1, permute_block / w);
+
+			parallel_for((n + b - 1) / b, [&](size_t k) {
+				for (size_t i = k * b; i < std::min(n, (k + 1) * b); ++i) {
+					std::memcpy(y.data() + i * w, x + (size_t)p[i] * w, w * sizeof(double));
+				}
+			});
+			parallel_for((n + b - 1) / b, [&](size_t k) {
+				size_t i = k * b;
+				std::memcpy(x + i * w, y.data() + i * w, (std::min(n, i + b) - i) * w * sizeof(double));
+			});
+		}
+	}
+
+	// True if p is a permutation of 0, ..., n - 1.
+	inline bool is_permutation(size_t n, const double* p)
+	{
+		std::vector<bool> seen(n);
+
+		for (size_t i = 0; i < n; ++i) {
+			double pi = p[i];
+			if (!(pi >= 0 && pi < n) || pi != std::floor(pi) || seen[(size_t)pi]) {
+				return false;
+			}
+			seen[(size_t)pi] = true;
+		}
+
+		return true;
+	}
+
+	// Inverse q of permutation p.
+	inline void inverse_permutation(size_t n, const double* p, double* q)
+	{
+		parallel_for(n, [=](size_t i) {
+			q[(size_t)p[i]] = static_cast<double>(i);
+		}, permute_block);
+	}
+
+	// Replace item i of width w by item p[i] in place.
+	inline void permute(double* x, size_t n, size_t w, const double* p)
+	{
+		if (n * w <= permute_block || n * w > permute_buffer) {
+			permute_::cycles(x, n, w, p);
+		}
+		else {
+			permute_::gather(x, n, w, p);
+		}
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int permute_test()
+	{
+		{
+			double p[] = { 2, 0, 1, 3 };
+			assert(is_permutation(4, p));
+			double q[4];
+			inverse_permutation(4, p, q);
+			assert(q[0] == 1 && q[1] == 2 && q[2] == 0 && q[3] == 3);
+
+			double x[] = { 10, 11, 12, 13 };
+			permute(x, 4, 1, p);
+			assert(x[0] == 12 && x[1] == 10 && x[2] == 11 && x[3] == 13);
+			permute(x, 4, 1, q);
+			assert(x[0] == 10 && x[1] == 11 && x[2] == 12 && x[3] == 13);
+
+			double bad[] = { 0, 0, 1, 3 };
+			assert(!is_permutation(4, bad));
+			double out[] = { 0, 4, 1, 2 };
+			assert(!is_permutation(4, out));
+		}
+		{
+			// rows
+			double p[] = { 1, 0 };
+			double x[] = { 1, 2, 3, 4, 5, 6 };
+			permute(x, 2, 3, p);
+			assert(x[0] == 4 && x[2] == 6 && x[3] == 1 && x[5] == 3);
+		}
+		{
+			// cycles and gather agree
+			size_t n = 1000;
+			std::vector<double> p(n), x(n), y;
+			for (size_t i = 0; i < n; ++i) {
+				p[i] = double((i * 7) % n);
+				x[i] = double(i);
+			}
+			assert(is_permutation(n, p.data()));
+			y = x;
+			permute_::cycles(x.data(), n, 1, p.data());
+			size_t block = permute_block;
+			permute_block = 16;
+			permute_::gather(y.data(), n, 1, p.data());
+			permute_block = block;
+			assert(x == y);
+			for (size_t i = 0; i < n; ++i) {
+				assert(x[i] == p[i]);
+			}
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_permute.t.cpp - permutation tests
+#include "fms_permute.h"
+
+#ifdef _DEBUG
+int fms_permute_test = fms::permute_test();
+#endif // _DEBUG
@@ -0,0 +1,309 @@
+// fms_pool.h - size class pool allocator for scratch buffers
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace fms {
+
+	inline const char pool_doc[] = R"xyzyx(
+The <em>pool</em> serves small allocations from slabs of fixed size blocks in
+power of 2 size classes and large allocations from chunks aligned to huge pages.
+Freed blocks go on a free list for their class and freed chunks are cached for
+reuse up to a limit.
+It is used for the scratch buffers of array algorithms. Arrays returned to Excel
+and arrays held by handles are allocated by the xll library and do not use the pool.
+)xyzyx";
+
+	// largest allocation served from a slab
+	inline constexpr size_t pool_small = 1 << 16;
+	// size of slabs carved into blocks
+	inline constexpr size_t pool_slab = 1 << 20;
+	// alignment and granularity of large chunks
+	inline constexpr size_t pool_huge = 1 << 21;
+	// most bytes of large chunks kept for reuse
+	inline size_t pool_cache = size_t(1) << 28;
+
+	class pool {
+		static constexpr size_t min_class = 16;
+		static constexpr size_t classes = std::countr_zero(pool_small) - std::countr_zero(min_class) + 1;
+
+		struct node {
+			node* next;
+		};
+		struct size_class {
+			std::mutex m;
+			node* free = nullptr;
+			std::vector<void*> slabs;
+		};
+		size_class small[classes];
+
+		std::mutex m; // large chunks
+		std::multimap<size_t, void*> cached;
+		std::unordered_map<void*, size_t> chunk;
+		size_t cached_bytes = 0;
+
+		std::atomic<size_t> allocations_ = 0, deallocations_ = 0, reuses_ = 0, bytes_ = 0;
+
+		static size_t index(size_t n)
+		{
+			return std::countr_zero(std::bit_ceil(std::max(n, min_class))) - std::countr_zero(min_class);
+		}
+		void* allocate_small(size_t n)
+		{
+			const size_t i = index(n);
+			const size_t b = min_class << i;
+			size_class& c = small[i];
+			std::lock_guard<std::mutex> lock(c.m);
+
+			if (c.free) {
+				++reuses_;
+			}
+			else {
+				char* s = static_cast<char*>(::operator new(pool_slab, std::align_val_t(min_class)));
+				c.slabs.push_back(s);
+				for (size_t k = pool_slab; k >= b; k -= b) {
+					node* p = reinterpret_cast<node*>(s + k - b);
+					p->next = c.free;
+					c.free = p;
+				}
+			}
+			node* p = c.free;
+			c.free = p->next;
+
+			return p;
+		}
+		void deallocate_small(void* p, size_t n)
+		{
+			size_class& c = small[index(n)];
+			std::lock_guard<std::mutex> lock(c.m);
+
+			node* q = static_cast<node*>(p);
+			q->next = c.free;
+			c.free = q;
+		}
+		void* allocate_large(size_t n)
+		{
+			if (n > SIZE_MAX - pool_huge) {
+				throw std::bad_alloc();
+			}
+			const size_t b = (n + pool_huge - 1) / pool_huge * pool_huge;
+			std::lock_guard<std::mutex> lock(m);
+
+			// reuse a cached chunk at most twice the size needed
+			auto i = cached.lower_bound(b);
+			if (i != cached.end() && i->first <= 2 * b) {
+				void* p = i->second;
+				cached_bytes -= i->first;
+				cached.erase(i);
+				++reuses_;
+
+				return p;
+			}
+
+			void* p = ::operator new(b, std::align_val_t(pool_huge));
+			chunk[p] = b;
+
+			return p;
+		}
+		// false if p was not allocated by the pool
+		bool deallocate_large(void* p)
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			auto c = chunk.find(p);
+			if (c == chunk.end()) {
+				return false;
+			}
+			const size_t b = c->second;
+			cached.emplace(b, p);
+			cached_bytes += b;
+			// release the largest chunks when over the limit
+			while (cached_bytes > pool_cache && !cached.empty()) {
+				auto i = std::prev(cached.end());
+				cached_bytes -= i->first;
+				chunk.erase(i->second);
+				::operator delete(i->second, std::align_val_t(pool_huge));
+				cached.erase(i);
+			}
+
+			return true;
+		}
+	public:
+		struct statistics {
+			size_t allocations;   // calls to allocate
+			size_t deallocations; // calls to deallocate
+			size_t reuses;        // allocations served from a free list or cached chunk
+			size_t bytes;         // bytes requested and not yet deallocated
+			size_t cached;        // bytes of large chunks held for reuse
+		};
+
+		pool() = default;
+		pool(const pool&) = delete;
+		pool& operator=(const pool&) = delete;
+		~pool()
+		{
+			trim();
+			for (auto& c : small) {
+				for (void* s : c.slabs) {
+					::operator delete(s, std::align_val_t(min_class));
+				}
+			}
+			for (auto& [p, b] : chunk) {
+				::operator delete(p, std::align_val_t(pool_huge));
+			}
+		}
+
+		// never destroyed so storage can outlive static objects
+		static pool& instance()
+		{
+			static pool* p = new pool;
+
+			return *p;
+		}
+
+		void* allocate(size_t n)
+		{
+			void* p = n <= pool_small ? allocate_small(n) : allocate_large(n);
+			++allocations_;
+			bytes_ += n;
+
+			return p;
+		}
+		void deallocate(void* p, size_t n)
+		{
+			if (!p) {
+				return;
+			}
+
+			if (n <= pool_small) {
+				deallocate_small(p, n);
+			}
+			else if (!deallocate_large(p)) {
+				return;
+			}
+			++deallocations_;
+			bytes_ -= n;
+		}
+
+		// release cached large chunks
+		void trim()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			for (auto& [b, p] : cached) {
+				chunk.erase(p);
+				::operator delete(p, std::align_val_t(pool_huge));
+			}
+			cached.clear();
+			cached_bytes = 0;
+		}
+
+		statistics stats()
+		{
+			std::lock_guard<std::mutex> lock(m);
+
+			return statistics{ allocations_, deallocations_, reuses_, bytes_, cached_bytes };
+		}
+	};
+
+	// Standard allocator using the pool.
+	template<class T>
+	struct pool_allocator {
+		using value_type = T;
+
+		pool_allocator() noexcept = default;
+		template<class U>
+		pool_allocator(const pool_allocator<U>&) noexcept
+		{ }
+
+		T* allocate(size_t n)
+		{
+			if (n > SIZE_MAX / sizeof(T)) {
+				throw std::bad_array_new_length();
+			}
+
+			return static_cast<T*>(pool::instance().allocate(n * sizeof(T)));
+		}
+		void deallocate(T* p, size_t n) noexcept
+		{
+			pool::instance().deallocate(p, n * sizeof(T));
+		}
+
+		template<class U>
+		bool operator==(const pool_allocator<U>&) const noexcept
+		{
+			return true;
+		}
+	};
+
+	template<class T>
+	using pool_vector = std::vector<T, pool_allocator<T>>;
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int pool_test()
+	{
+		{
+			pool& p = pool::instance();
+			auto s0 = p.stats();
+			void* a = p.allocate(24);
+			void* b = p.allocate(24);
+			assert(a != b);
+			assert(reinterpret_cast<uintptr_t>(a) % 16 == 0);
+			p.deallocate(a, 24);
+			void* c = p.allocate(17);
+			assert(c == a); // same size class from the free list
+			p.deallocate(b, 24);
+			p.deallocate(c, 17);
+			auto s1 = p.stats();
+			assert(s1.allocations - s0.allocations == 3);
+			assert(s1.deallocations - s0.deallocations == 3);
+			assert(s1.bytes == s0.bytes);
+		}
+		{
+			pool& p = pool::instance();
+			void* a = p.allocate(3 * pool_huge / 2);
+			assert(reinterpret_cast<uintptr_t>(a) % pool_huge == 0);
+			p.deallocate(a, 3 * pool_huge / 2);
+			assert(p.stats().cached >= 2 * pool_huge);
+			void* b = p.allocate(2 * pool_huge);
+			assert(b == a); // cached chunk reused
+			p.deallocate(b, 2 * pool_huge);
+			p.trim();
+			assert(p.stats().cached == 0);
+
+			// unknown chunks are ignored
+			auto s0 = p.stats();
+			int x;
+			p.deallocate(&x, 2 * pool_huge);
+			auto s1 = p.stats();
+			assert(s1.cached == 0 && s1.bytes == s0.bytes && s1.deallocations == s0.deallocations);
+		}
+		{
+			pool_vector<double> v(1000, 1.);
+			v.resize(100000, 2.);
+			assert(v[0] == 1 && v[99999] == 2);
+
+			bool thrown = false;
+			try {
+				pool_allocator<double>().allocate(SIZE_MAX / 4);
+			}
+			catch (const std::bad_array_new_length&) {
+				thrown = true;
+			}
+			assert(thrown);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
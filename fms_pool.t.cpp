@@ -0,0 +1,6 @@
+// fms_pool.t.cpp - pool allocator tests
+#include "fms_pool.h"
+
+#ifdef _DEBUG
+int fms_pool_test = fms::pool_test();
+#endif // _DEBUG
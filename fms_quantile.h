@@ -0,0 +1,193 @@
+// fms_quantile.h - quantiles and histograms without a full sort
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char quantile_doc[] = R"xyzyx(
+The <em>p-quantile</em> of n values is <code>x[h] + (h - [h])(x[h + 1] - x[h])</code> where
+<code>x</code> are the sorted values and <code>h = (n - 1)p</code>. This is Excel's <code>PERCENTILE.INC</code>.
+)xyzyx";
+
+	// number of values counted by one task
+	inline size_t histogram_block = 1 << 16;
+
+	namespace quantile_ {
+
+		// Put the k[i]-th order statistics of x[lo, hi) in place where lo <= k[i] < hi.
+		// Selecting the middle index splits the problem so this is O(n log nk).
+		inline void select(double* x, size_t lo, size_t hi, const size_t* k, size_t nk)
+		{
+			if (nk == 0 || hi - lo <= 1) {
+				return;
+			}
+
+			size_t m = nk / 2;
+			std::nth_element(x + lo, x + k[m], x + hi);
+			select(x, lo, k[m], k, m);
+			select(x, k[m] + 1, hi, k + m + 1, nk - m - 1);
+		}
+
+		template<class Bin>
+		inline void count(const double* x, size_t n, size_t nb, double* c, Bin bin)
+		{
+			const size_t b = histogram_block;
+			const size_t nblk = (n + b - 1) / b;
+			std::vector<std::vector<size_t>> part(nblk);
+
+			// per task counts are merged at the end
+			parallel_for(nblk, [&](size_t i) {
+				std::vector<size_t> h(nb + 1); // last is out of range
+				for (size_t j = i * b; j < std::min(n, (i + 1) * b); ++j) {
+					++h[bin(x[j])];
+				}
+				part[i] = std::move(h);
+			});
+
+			std::fill(c, c + nb, 0.);
+			for (const auto& h : part) {
+				for (size_t j = 0; j < nb; ++j) {
+					c[j] += static_cast<double>(h[j]);
+				}
+			}
+		}
+	}
+
+	// Put the order statistics k[0] < k[1] < ... in place, reorders x.
+	inline void select(double* x, size_t n, const size_t* k, size_t nk)
+	{
+		quantile_::select(x, 0, n, k, nk);
+	}
+
+	// Quantiles q[i] of x at probabilities p[i]. Reorders x, NaN values are ignored.
+	// A NaN probability has a NaN quantile.
+	inline void quantile(double* x, size_t n, const double* p, size_t np, double* q)
+	{
+		n = std::partition(x, x + n, [](double xi) { return !std::isnan(xi); }) - x;
+		if (n == 0) {
+			std::fill(q, q + np, NAN);
+
+			return;
+		}
+
+		// order statistics on either side of each h
+		std::vector<size_t> k;
+		for (size_t i = 0; i < np; ++i) {
+			if (std::isnan(p[i])) {
+				continue;
+			}
+			double h = (n - 1) * std::clamp(p[i], 0., 1.);
+			k.push_back(static_cast<size_t>(std::floor(h)));
+			k.push_back(std::min(n - 1, k.back() + 1));
+		}
+		std::sort(k.begin(), k.end());
+		k.erase(std::unique(k.begin(), k.end()), k.end());
+
+		select(x, n, k.data(), k.size());
+
+		for (size_t i = 0; i < np; ++i) {
+			if (std::isnan(p[i])) {
+				q[i] = NAN;
+
+				continue;
+			}
+			double h = (n - 1) * std::clamp(p[i], 0., 1.);
+			size_t h_ = static_cast<size_t>(std::floor(h));
+			q[i] = x[h_];
+			if (h_ + 1 < n) {
+				q[i] += (h - h_) * (x[h_ + 1] - x[h_]);
+			}
+		}
+	}
+
+	// Count x in [e[i], e[i + 1]) for increasing edges e[0], ..., e[ne - 1].
+	// The last bin includes its right edge.
+	inline void histogram(const double* x, size_t n, const double* e, size_t ne, double* c)
+	{
+		if (ne < 2) {
+			return;
+		}
+
+		const size_t nb = ne - 1;
+		quantile_::count(x, n, nb, c, [e, ne, nb](double xi) {
+			if (!(xi >= e[0] && xi <= e[nb])) {
+				return nb;
+			}
+			size_t i = std::upper_bound(e, e + ne, xi) - e - 1;
+
+			return std::min(i, nb - 1);
+		});
+	}
+
+	// Count x in nb equal width bins from lo to hi.
+	inline void histogram(const double* x, size_t n, double lo, double hi, size_t nb, double* c)
+	{
+		if (nb == 0) {
+			return;
+		}
+
+		const double scale = hi > lo ? nb / (hi - lo) : 0;
+		quantile_::count(x, n, nb, c, [lo, hi, nb, scale](double xi) {
+			if (!(xi >= lo && xi <= hi)) {
+				return nb;
+			}
+
+			return std::min(static_cast<size_t>((xi - lo) * scale), nb - 1);
+		});
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int quantile_test()
+	{
+		{
+			double x[] = { 5, 1, 4, 2, 3 };
+			double p[] = { 0, 0.5, 1, 0.125 };
+			double q[4];
+			quantile(x, 5, p, 4, q);
+			assert(q[0] == 1);
+			assert(q[1] == 3);
+			assert(q[2] == 5);
+			assert(q[3] == 1.5);
+
+			double pn[] = { NAN, 0.5 };
+			quantile(x, 5, pn, 2, q);
+			assert(std::isnan(q[0]));
+			assert(q[1] == 3);
+		}
+		{
+			size_t n = 1001;
+			std::vector<double> x(n), y;
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = double((i * 7919) % n);
+			}
+			y = x;
+			std::sort(y.begin(), y.end());
+			size_t k[] = { 0, 10, 500, 501, 999, 1000 };
+			select(x.data(), n, k, 6);
+			for (size_t i : k) {
+				assert(x[i] == y[i]);
+			}
+		}
+		{
+			size_t block = histogram_block;
+			histogram_block = 3;
+			double x[] = { 0, 0.5, 1, 1.5, 2, 2, -1, 3, NAN };
+			double e[] = { 0, 1, 2 };
+			double c[2];
+			histogram(x, 9, e, 3, c);
+			assert(c[0] == 2 && c[1] == 4);
+			histogram(x, 9, 0., 2., 2, c);
+			assert(c[0] == 2 && c[1] == 4);
+			histogram_block = block;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
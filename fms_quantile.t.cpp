@@ -0,0 +1,6 @@
+// fms_quantile.t.cpp - quantile and histogram tests
+#include "fms_quantile.h"
+
+#ifdef _DEBUG
+int fms_quantile_test = fms::quantile_test();
+#endif // _DEBUG
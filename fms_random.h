@@ -0,0 +1,168 @@
+// fms_random.h - counter-based random numbers
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char random_doc[] = R"xyzyx(
+Random numbers are generated by the Philox 4x32-10 counter-based generator.
+The value at index \(i\) depends only on \(i\) and the seed so any range of
+indices can be generated independently, in parallel, and reproducibly.
+)xyzyx";
+
+	// number of doubles generated by one task
+	inline size_t random_block = 1 << 16;
+
+	enum class random_distribution {
+		uniform,    // (0, 1)
+		normal,     // mean 0, variance 1
+		exponential // mean 1
+	};
+
+	// Philox 4x32 with 10 rounds
+	inline std::array<uint32_t, 4> philox(std::array<uint32_t, 4> c, std::array<uint32_t, 2> k)
+	{
+		for (int r = 0; r < 10; ++r) {
+			const uint64_t p0 = uint64_t(0xD2511F53) * c[0];
+			const uint64_t p1 = uint64_t(0xCD9E8D57) * c[2];
+			c = {
+				uint32_t(p1 >> 32) ^ c[1] ^ k[0],
+				uint32_t(p1),
+				uint32_t(p0 >> 32) ^ c[3] ^ k[1],
+				uint32_t(p0)
+			};
+			k[0] += 0x9E3779B9;
+			k[1] += 0xBB67AE85;
+		}
+
+		return c;
+	}
+
+	namespace random_ {
+
+		// two uniforms in (0, 1) from counter i
+		inline void uniform2(uint64_t i, uint64_t seed, double* u)
+		{
+			auto r = philox({ uint32_t(i), uint32_t(i >> 32), 0, 0 }, { uint32_t(seed), uint32_t(seed >> 32) });
+			const uint64_t a = (uint64_t(r[0]) << 32) | r[1];
+			const uint64_t b = (uint64_t(r[2]) << 32) | r[3];
+			u[0] = ((a >> 11) + 0.5) * 0x1p-53;
+			u[1] = ((b >> 11) + 0.5) * 0x1p-53;
+		}
+
+		// x[0, n) for indices [o, o + n) where o is even
+		inline void block(double* x, size_t n, size_t o, random_distribution d, uint64_t seed)
+		{
+			size_t i = 0;
+			for (; i + 2 <= n; i += 2) {
+				uniform2((o + i) / 2, seed, x + i);
+			}
+			if (i < n) {
+				double u[2];
+				uniform2((o + i) / 2, seed, u);
+				x[i] = u[0];
+			}
+
+			switch (d) {
+			case random_distribution::normal:
+				// Box-Muller on pairs so the value at an index does not depend on n
+				for (i = 0; i + 2 <= n; i += 2) {
+					const double r = std::sqrt(-2 * std::log(x[i]));
+					const double t = 2 * std::numbers::pi * x[i + 1];
+					x[i] = r * std::cos(t);
+					x[i + 1] = r * std::sin(t);
+				}
+				if (i < n) {
+					double u[2];
+					uniform2((o + i) / 2, seed, u);
+					x[i] = std::sqrt(-2 * std::log(u[0])) * std::cos(2 * std::numbers::pi * u[1]);
+				}
+				break;
+			case random_distribution::exponential:
+				for (i = 0; i < n; ++i) {
+					x[i] = -std::log(x[i]);
+				}
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	// Set x[i] to the random variate at index o + i for i < n.
+	inline void random(double* x, size_t n, random_distribution d, uint64_t seed, uint64_t o = 0)
+	{
+		if (o % 2) {
+			double y[2];
+			random_::block(y, 2, o - 1, d, seed);
+			if (n) {
+				x[0] = y[1];
+				++x;
+				--n;
+				++o;
+			}
+		}
+
+		const size_t b = std::max<size_t>(2, random_block & ~size_t(1)); // even
+		const size_t nb = (n + b - 1) / b;
+		parallel_for(nb, [=](size_t k) {
+			random_::block(x + k * b, std::min(b, n - k * b), o + k * b, d, seed);
+		});
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int random_test()
+	{
+		{
+			// known answer
+			auto r = philox({ 0, 0, 0, 0 }, { 0, 0 });
+			assert(r[0] == 0x6627e8d5 && r[1] == 0xe169c58d && r[2] == 0xbc57ac4c && r[3] == 0x9b00dbd8);
+		}
+		{
+			// independent of block size and offset
+			size_t block = random_block;
+			for (auto d : { random_distribution::uniform, random_distribution::normal, random_distribution::exponential }) {
+				size_t n = 1001;
+				std::vector<double> x(n), y(n);
+				random_block = 1 << 16;
+				random(x.data(), n, d, 123);
+				random_block = 10;
+				random(y.data(), n, d, 123);
+				assert(x == y);
+				random(y.data() + 7, 100, d, 123, 7);
+				assert(x == y);
+				random(y.data(), n, d, 124);
+				assert(x != y);
+			}
+			random_block = block;
+		}
+		{
+			size_t n = 100000;
+			std::vector<double> x(n);
+			random(x.data(), n, random_distribution::normal, 1);
+			double m = 0, v = 0;
+			for (double xi : x) {
+				m += xi;
+				v += xi * xi;
+			}
+			m /= n;
+			v = v / n - m * m;
+			assert(std::fabs(m) < 0.02 && std::fabs(v - 1) < 0.02);
+
+			random(x.data(), n, random_distribution::uniform, 1);
+			assert(*std::min_element(x.begin(), x.end()) > 0 && *std::max_element(x.begin(), x.end()) < 1);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
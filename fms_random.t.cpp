@@ -0,0 +1,6 @@
+// fms_random.t.cpp - random number tests
+#include "fms_random.h"
+
+#ifdef _DEBUG
+int fms_random_test = fms::random_test();
+#endif // _DEBUG
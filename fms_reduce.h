@@ -0,0 +1,150 @@
+// fms_reduce.h - reduce rows or columns of a 2-d array with a monoid
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "fms_parallel.h"
+#include "fms_pool.h"
+
+namespace fms {
+
+	inline const char reduce_doc[] = R"xyzyx(
+<em>Reduction</em> folds the rows or columns of an array with
+an associative binary operation and its identity.
+Items are combined in their original order so the operation
+need not be commutative.
+)xyzyx";
+
+	// number of doubles reduced by one task
+	inline size_t reduce_block = 1 << 16;
+
+	namespace reduce_ {
+
+		// Fold n contiguous doubles using four independent chains over contiguous quarters.
+		template<class Op>
+		inline double row(size_t n, const double* x, double id, Op op)
+		{
+			const size_t q = n / 4;
+			double a0 = id, a1 = id, a2 = id, a3 = id;
+
+			for (size_t i = 0; i < q; ++i) {
+				a0 = op(a0, x[i]);
+				a1 = op(a1, x[q + i]);
+				a2 = op(a2, x[2 * q + i]);
+				a3 = op(a3, x[3 * q + i]);
+			}
+			for (size_t i = 4 * q; i < n; ++i) {
+				a3 = op(a3, x[i]);
+			}
+
+			return op(op(a0, a1), op(a2, a3));
+		}
+
+		// Accumulate rows [b, e) of the r x c array a into y elementwise.
+		template<class Op>
+		inline void columns(size_t c, const double* a, size_t b, size_t e, double* y, Op op)
+		{
+			for (size_t i = b; i < e; ++i) {
+				const double* ai = a + i * c;
+				for (size_t j = 0; j < c; ++j) {
+					y[j] = op(y[j], ai[j]);
+				}
+			}
+		}
+	}
+
+	// Set y[i] to the fold of row i of the r x c array a.
+	template<class Op>
+	inline void reduce_rows(size_t r, size_t c, const double* a, double id, Op op, double* y)
+	{
+		const size_t b = std::max<size_t>(1, reduce_block / std::max<size_t>(c, 1)); // rows per block
+		const size_t nb = (r + b - 1) / b;
+
+		parallel_for(nb, [=](size_t k) {
+			for (size_t i = k * b; i < std::min(r, (k + 1) * b); ++i) {
+				y[i] = reduce_::row(c, a + i * c, id, op);
+			}
+		});
+	}
+
+	// Set y[j] to the fold of column j of the r x c array a.
+	// Blocks of rows are accumulated in parallel and the partial results combined in order.
+	template<class Op>
+	inline void reduce_columns(size_t r, size_t c, const double* a, double id, Op op, double* y)
+	{
+		std::fill(y, y + c, id);
+		if (r == 0 || c == 0) {
+			return;
+		}
+
+		const size_t b = std::max<size_t>(1, reduce_block / c); // rows per block
+		const size_t nb = (r + b - 1) / b;
+
+		if (nb == 1) {
+			reduce_::columns(c, a, 0, r, y, op);
+
+			return;
+		}
+
+		pool_vector<double> part(nb * c, id);
+		parallel_for(nb, [=, &part](size_t k) {
+			reduce_::columns(c, a, k * b, std::min(r, (k + 1) * b), part.data() + k * c, op);
+		});
+		reduce_::columns(c, part.data(), 0, nb, y, op);
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int reduce_test()
+	{
+		{
+			double a[] = { 1, 2, 3, 4, 5, 6 };
+			double y[3];
+			reduce_rows(2, 3, a, 0., std::plus<double>{}, y);
+			assert(y[0] == 6 && y[1] == 15);
+			reduce_columns(2, 3, a, 0., std::plus<double>{}, y);
+			assert(y[0] == 5 && y[1] == 7 && y[2] == 9);
+			reduce_columns(2, 3, a, 1., std::multiplies<double>{}, y);
+			assert(y[0] == 4 && y[1] == 10 && y[2] == 18);
+		}
+		{
+			// order is preserved for non-commutative operations
+			size_t block = reduce_block;
+			reduce_block = 8;
+			auto first = [](double x, double y) { return x == x ? x : y; }; // identity NaN
+			size_t r = 37, c = 11;
+			std::vector<double> a(r * c), y(std::max(r, c));
+			for (size_t i = 0; i < a.size(); ++i) {
+				a[i] = double(i);
+			}
+			reduce_rows(r, c, a.data(), NAN, first, y.data());
+			for (size_t i = 0; i < r; ++i) {
+				assert(y[i] == a[i * c]);
+			}
+			reduce_columns(r, c, a.data(), NAN, first, y.data());
+			for (size_t j = 0; j < c; ++j) {
+				assert(y[j] == a[j]);
+			}
+			auto last = [](double x, double y) { return y == y ? y : x; };
+			reduce_rows(r, c, a.data(), NAN, last, y.data());
+			for (size_t i = 0; i < r; ++i) {
+				assert(y[i] == a[i * c + c - 1]);
+			}
+			reduce_columns(r, c, a.data(), NAN, last, y.data());
+			for (size_t j = 0; j < c; ++j) {
+				assert(y[j] == a[(r - 1) * c + j]);
+			}
+			reduce_columns(r, c, a.data(), 0., std::plus<double>{}, y.data());
+			for (size_t j = 0; j < c; ++j) {
+				assert(y[j] == c * r * (r - 1) / 2 + r * j);
+			}
+			reduce_block = block;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
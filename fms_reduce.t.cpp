@@ -0,0 +1,6 @@
+// fms_reduce.t.cpp - reduction tests
+#include "fms_reduce.h"
+
+#ifdef _DEBUG
+int fms_reduce_test = fms::reduce_test();
+#endif // _DEBUG
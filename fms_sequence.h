@@ -0,0 +1,157 @@
+// fms_sequence.h - virtual arithmetic sequences
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char sequence_doc[] = R"xyzyx(
+A <em>sequence</em> <code>{start, start + incr, ..., start + (count - 1) incr}</code>
+is stored as its start, increment, and count. Items are computed when needed
+so no memory is used for the items.
+)xyzyx";
+
+	// number of doubles materialized by one task
+	inline size_t sequence_block = 1 << 16;
+
+	struct sequence {
+		double start;
+		double incr;
+		size_t count;
+
+		double operator[](size_t i) const
+		{
+			return start + static_cast<double>(i) * incr;
+		}
+		size_t size() const
+		{
+			return count;
+		}
+	};
+
+	// largest count of a sequence, items are exactly representable
+	inline constexpr double sequence_max = 0x1p53;
+
+	// Sequence from start to stop. If incr is greater than 1 it is the count.
+	// If incr is 0 it is 1 or -1 in the direction of stop.
+	inline sequence make_sequence(double start, double stop, double incr = 0)
+	{
+		if (!std::isfinite(start) || !std::isfinite(stop) || !std::isfinite(incr)) {
+			throw std::invalid_argument("make_sequence: start, stop, and incr must be finite");
+		}
+		if (incr == 0) {
+			incr = start > stop ? -1 : 1;
+		}
+
+		// number of items after the first
+		double n_ = incr > 1 ? incr - 1 : std::fabs((stop - start) / incr);
+		if (!(n_ < sequence_max)) {
+			throw std::invalid_argument("make_sequence: too many items");
+		}
+
+		size_t n;
+		if (incr > 1) {
+			n = static_cast<size_t>(incr);
+			incr = n > 1 ? (stop - start) / (n - 1) : 0;
+		}
+		else {
+			n = 1 + static_cast<size_t>(n_);
+		}
+
+		return sequence{ start, incr, n };
+	}
+
+	// Set x[i] = s[o + i] for i < n.
+	inline void materialize(const sequence& s, double* x, size_t n, size_t o = 0)
+	{
+		const size_t b = sequence_block;
+		const size_t nb = (n + b - 1) / b;
+		parallel_for(nb, [=](size_t k) {
+			for (size_t i = k * b; i < std::min(n, (k + 1) * b); ++i) {
+				x[i] = s[o + i];
+			}
+		});
+	}
+
+	// Number of items of s kept by the cyclic mask m of size nm.
+	inline size_t mask_count(const sequence& s, const double* m, size_t nm)
+	{
+		if (nm == 0) {
+			return s.count;
+		}
+
+		const size_t q = s.count / nm, r = s.count % nm;
+		const auto keep = [](double mi) { return mi != 0; };
+
+		return q * std::count_if(m, m + nm, keep) + std::count_if(m, m + r, keep);
+	}
+
+	// Set y to the items of s kept by the cyclic mask m of size nm. Return the number kept.
+	inline size_t mask(const sequence& s, const double* m, size_t nm, double* y)
+	{
+		if (nm == 0) {
+			materialize(s, y, s.count);
+
+			return s.count;
+		}
+
+		size_t k = 0;
+		for (size_t i = 0; i < s.count; ++i) {
+			if (m[i % nm] != 0) {
+				y[k++] = s[i];
+			}
+		}
+
+		return k;
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int sequence_test()
+	{
+		{
+			auto s = make_sequence(1, 5);
+			assert(s.count == 5 && s[0] == 1 && s[4] == 5);
+			s = make_sequence(5, 1);
+			assert(s.count == 5 && s[0] == 5 && s[4] == 1);
+			s = make_sequence(0, 1, 5);
+			assert(s.count == 5 && s[1] == 0.25 && s[4] == 1);
+			s = make_sequence(0, 1, 0.5);
+			assert(s.count == 3 && s[2] == 1);
+
+			for (double incr : { 1e-300, double(NAN), double(INFINITY) }) {
+				bool thrown = false;
+				try {
+					make_sequence(0, 1, incr);
+				}
+				catch (const std::invalid_argument&) {
+					thrown = true;
+				}
+				assert(thrown);
+			}
+		}
+		{
+			size_t block = sequence_block;
+			sequence_block = 7;
+			auto s = make_sequence(0, 99);
+			std::vector<double> x(100);
+			materialize(s, x.data(), x.size());
+			for (size_t i = 0; i < x.size(); ++i) {
+				assert(x[i] == i);
+			}
+			double m[] = { 0, 1, 1 };
+			assert(mask_count(s, m, 3) == 66);
+			assert(mask(s, m, 3, x.data()) == 66);
+			assert(x[0] == 1 && x[1] == 2 && x[2] == 4 && x[65] == 98);
+			sequence_block = block;
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_sequence.t.cpp - sequence tests
+#include "fms_sequence.h"
+
+#ifdef _DEBUG
+int fms_sequence_test = fms::sequence_test();
+#endif // _DEBUG
@@ -0,0 +1,270 @@
+// fms_sketch.h - KLL streaming quantile sketch
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "fms_monoid.h"
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char kll_doc[] = R"xyzyx(
+The KLL sketch of Karnin, Lang, and Liberty keeps a hierarchy of compactors.
+Level <code>h</code> items have weight <code>2<sup>h</sup></code>.
+When a level is full it is sorted and every other item is promoted to the next level.
+The rank error is about <code>1.7/k</code> using <code>O(k)</code> memory.
+Sketches can be merged so they form a monoid.
+)xyzyx";
+
+	class kll {
+		size_t k;
+		uint64_t n; // number of values added
+		uint64_t seed; // coin flips for compaction
+		std::vector<std::vector<double>> level;
+		size_t items_; // total items in all levels
+		size_t capacity_; // total capacity of all levels
+
+		// capacity of level h, lower levels decay by 2/3
+		size_t capacity(size_t h) const
+		{
+			size_t depth = level.size() - 1 - h;
+
+			return std::max<size_t>(2, static_cast<size_t>(std::ceil(k * std::pow(2. / 3, double(depth)))));
+		}
+		void add_level()
+		{
+			level.emplace_back();
+			capacity_ = 0;
+			for (size_t h = 0; h < level.size(); ++h) {
+				capacity_ += capacity(h);
+			}
+		}
+		bool coin()
+		{
+			// xorshift64
+			seed ^= seed << 13;
+			seed ^= seed >> 7;
+			seed ^= seed << 17;
+
+			return seed & 1;
+		}
+		// Promote half of the first full level.
+		void compress()
+		{
+			for (size_t h = 0; h < level.size(); ++h) {
+				if (level[h].size() >= capacity(h)) {
+					if (h + 1 == level.size()) {
+						add_level();
+					}
+					auto& l = level[h];
+					// an odd item stays behind
+					double odd = 0;
+					bool is_odd = l.size() % 2;
+					if (is_odd) {
+						odd = l.back();
+						l.pop_back();
+					}
+					std::sort(l.begin(), l.end());
+					for (size_t i = coin(); i < l.size(); i += 2) {
+						level[h + 1].push_back(l[i]);
+					}
+					items_ -= l.size() / 2;
+					l.clear();
+					if (is_odd) {
+						l.push_back(odd);
+					}
+
+					return;
+				}
+			}
+		}
+	public:
+		kll(size_t k = 200, uint64_t seed = 0x9e3779b97f4a7c15ULL)
+			: k(std::max<size_t>(k, 8)), n(0), seed(seed ? seed : 1), items_(0), capacity_(0)
+		{
+			add_level();
+		}
+
+		// accuracy parameter
+		size_t parameter() const
+		{
+			return k;
+		}
+		// number of values added
+		uint64_t size() const
+		{
+			return n;
+		}
+		// memory used in doubles
+		size_t memory() const
+		{
+			return items_;
+		}
+
+		kll& add(double x)
+		{
+			if (!std::isnan(x)) {
+				level[0].push_back(x);
+				++items_;
+				++n;
+				if (items_ >= capacity_) {
+					compress();
+				}
+			}
+
+			return *this;
+		}
+		kll& add(const double* x, size_t m)
+		{
+			for (size_t i = 0; i < m; ++i) {
+				add(x[i]);
+			}
+
+			return *this;
+		}
+		kll& merge(const kll& s)
+		{
+			if (&s == this) {
+				kll t(s);
+
+				return merge(t);
+			}
+
+			while (level.size() < s.level.size()) {
+				add_level();
+			}
+			for (size_t h = 0; h < s.level.size(); ++h) {
+				level[h].insert(level[h].end(), s.level[h].begin(), s.level[h].end());
+			}
+			items_ += s.items_;
+			n += s.n;
+			while (items_ >= capacity_) {
+				compress();
+			}
+
+			return *this;
+		}
+
+		// Approximate p-quantile, NaN if empty or p is NaN.
+		double quantile(double p) const
+		{
+			if (std::isnan(p)) {
+				return NAN;
+			}
+
+			std::vector<std::pair<double, uint64_t>> xw;
+			for (size_t h = 0; h < level.size(); ++h) {
+				for (double x : level[h]) {
+					xw.emplace_back(x, uint64_t(1) << h);
+				}
+			}
+			if (xw.empty()) {
+				return NAN;
+			}
+			std::sort(xw.begin(), xw.end());
+
+			uint64_t w = 0;
+			for (const auto& [x, wx] : xw) {
+				w += wx;
+			}
+			double r = std::clamp(p, 0., 1.) * double(w);
+			uint64_t c = 0;
+			for (const auto& [x, wx] : xw) {
+				c += wx;
+				if (double(c) >= r) {
+					return x;
+				}
+			}
+
+			return xw.back().first;
+		}
+	};
+
+	// Sketch of x[0], ..., x[m - 1] built from blocks in parallel and merged.
+	inline kll sketch(const double* x, size_t m, size_t k = 200, size_t block = 1 << 20)
+	{
+		const size_t nb = (m + block - 1) / block;
+		std::vector<kll> s(nb, kll(k));
+		parallel_for(nb, [&](size_t i) {
+			s[i] = kll(k, 0x9e3779b97f4a7c15ULL + i);
+			s[i].add(x + i * block, std::min(block, m - i * block));
+		});
+
+		kll t(k);
+		for (const auto& si : s) {
+			t.merge(si);
+		}
+
+		return t;
+	}
+
+	// Merging sketches is approximately associative.
+	class monoid_kll : public monoid<kll> {
+		size_t k;
+	public:
+		monoid_kll(size_t k = 200)
+			: k(k)
+		{ }
+		kll _op() const override
+		{
+			return kll(k);
+		}
+		kll _op(const kll& x, const kll& y) const override
+		{
+			kll z(x);
+
+			return z.merge(y);
+		}
+	};
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int kll_test()
+	{
+		{
+			kll s;
+			assert(s.size() == 0);
+			assert(std::isnan(s.quantile(0.5)));
+			s.add(1);
+			assert(s.quantile(0.5) == 1);
+			assert(std::isnan(s.quantile(NAN)));
+		}
+		{
+			size_t n = 100000;
+			std::vector<double> x(n);
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = double((i * 7919) % n);
+			}
+
+			kll s(200);
+			s.add(x.data(), n);
+			assert(s.size() == n);
+			assert(s.memory() < 1000);
+			for (double p : { 0.01, 0.1, 0.5, 0.9, 0.99 }) {
+				assert(std::fabs(s.quantile(p) - p * n) < 0.02 * n);
+			}
+
+			kll t = sketch(x.data(), n, 200, 10000);
+			assert(t.size() == n);
+			for (double p : { 0.01, 0.5, 0.99 }) {
+				assert(std::fabs(t.quantile(p) - p * n) < 0.02 * n);
+			}
+
+			monoid_kll m;
+			kll u = m(m(), t);
+			assert(u.size() == n);
+
+			// self merge doubles every weight
+			u.merge(u);
+			assert(u.size() == 2 * n);
+			assert(std::fabs(u.quantile(0.5) - 0.5 * n) < 0.02 * n);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_sketch.t.cpp - quantile sketch tests
+#include "fms_sketch.h"
+
+#ifdef _DEBUG
+int fms_kll_test = fms::kll_test();
+#endif // _DEBUG
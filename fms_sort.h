@@ -0,0 +1,389 @@
+// fms_sort.h - adaptive sort exploiting presorted runs
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "fms_parallel.h"
+#include "fms_pool.h"
+
+namespace fms {
+
+	inline const char sort_doc[] = R"xyzyx(
+An <em>adaptive sort</em> finds the maximal increasing or strictly decreasing
+runs of an array, reverses the decreasing ones, and merges neighbouring runs
+in the order given by the powersort rule. Merges skip over the parts of
+runs that are already in place and gallop when one run keeps winning.
+An array made of \(r\) runs is sorted in \(O(n\log r)\) so nearly sorted,
+reversed, or sorted arrays with a few appended items are sorted in close to linear time.
+)xyzyx";
+
+	// runs shorter than this are extended by insertion sort
+	inline size_t sort_minrun = 32;
+	// consecutive wins by one run before galloping
+	inline size_t sort_gallop = 7;
+	// use the adaptive sort if there are fewer than n/sort_presorted descents or ascents
+	inline size_t sort_presorted = 64;
+	// segments no longer than this are sorted by a sorting network
+	inline size_t sort_network = 16;
+	// number of items in the segments sorted by one task
+	inline size_t sort_block = 1 << 14;
+
+	namespace sort_ {
+
+		struct run {
+			size_t b, n; // start and length
+			unsigned p; // power of the boundary with the next run
+		};
+
+		// Powersort depth of the boundary between runs [b1, b1 + n1) and [b1 + n1, b1 + n1 + n2) in [0, n).
+		inline unsigned power(size_t b1, size_t n1, size_t n2, size_t n)
+		{
+			// twice the midpoints of the runs compared against 2n
+			uint64_t a = 2 * b1 + n1, b = a + n1 + n2, N = 2 * n;
+			unsigned p = 0;
+
+			for (;;) {
+				++p;
+				a *= 2;
+				b *= 2;
+				bool ha = a >= N, hb = b >= N;
+				if (ha != hb) {
+					return p;
+				}
+				if (ha) {
+					a -= N;
+					b -= N;
+				}
+			}
+		}
+
+		// First position in [first, last) where p is false, p must be true on a prefix.
+		// Exponential search is O(log k) for a prefix of length k.
+		template<class T, class P>
+		inline T* gallop(T* first, T* last, P p)
+		{
+			size_t k = 1;
+			T* lo = first;
+
+			while (static_cast<size_t>(last - lo) > k && p(lo[k - 1])) {
+				lo += k;
+				k *= 2;
+			}
+
+			return std::partition_point(lo, std::min(last, lo + k), p);
+		}
+
+		// Merge sorted [x, x + n1) and [x + n1, x + n1 + n2) stably using buf of size n1.
+		template<class T, class C>
+		inline void merge(T* x, size_t n1, size_t n2, T* buf, C lt)
+		{
+			T* m = x + n1;
+			T* e = m + n2;
+
+			// left items not greater than the first right item are in place
+			T* a0 = std::upper_bound(x, m, *m, lt);
+			// right items not less than the last left item are in place
+			T* be = std::lower_bound(m, e, *(m - 1), lt);
+			if (a0 == m || be == m) {
+				return;
+			}
+
+			T* a = buf;
+			T* ae = std::copy(a0, m, buf);
+			T* b = m;
+			T* o = a0;
+			size_t wa = 0, wb = 0;
+
+			while (a < ae && b < be) {
+				if (lt(*b, *a)) {
+					*o++ = *b++;
+					wa = 0;
+					if (++wb >= sort_gallop) {
+						T* g = gallop(b, be, [&](const T& v) { return lt(v, *a); });
+						o = std::copy(b, g, o);
+						b = g;
+						wb = 0;
+					}
+				}
+				else {
+					*o++ = *a++;
+					wb = 0;
+					if (++wa >= sort_gallop) {
+						T* g = gallop(a, ae, [&](const T& v) { return !lt(*b, v); });
+						o = std::copy(a, g, o);
+						a = g;
+						wa = 0;
+					}
+				}
+			}
+			// rest of right is in place
+			std::copy(a, ae, o);
+		}
+
+		// Odd-even transposition network. Compare-exchanges are branchless and
+		// only swap when strictly less so NaN stays put.
+		template<class T, class C>
+		inline void network(T* x, size_t n, C lt)
+		{
+			for (size_t k = 0; k < n; ++k) {
+				for (size_t i = k & 1; i + 1 < n; i += 2) {
+					T a = x[i], b = x[i + 1];
+					bool s = lt(b, a);
+					x[i] = s ? b : a;
+					x[i + 1] = s ? a : b;
+				}
+			}
+		}
+
+		// End of the run starting at b, reversing strictly decreasing runs and extending short runs.
+		template<class T, class C>
+		inline size_t next_run(T* x, size_t b, size_t n, C lt)
+		{
+			size_t e = b + 1;
+
+			if (e < n) {
+				if (lt(x[e], x[b])) {
+					while (e < n && lt(x[e], x[e - 1])) {
+						++e;
+					}
+					std::reverse(x + b, x + e);
+				}
+				else {
+					while (e < n && !lt(x[e], x[e - 1])) {
+						++e;
+					}
+				}
+			}
+
+			size_t m = std::min(n, b + sort_minrun);
+			if (e < m) {
+				// insertion sort
+				for (; e < m; ++e) {
+					T v = x[e];
+					size_t j = e;
+					for (; j > b && lt(v, x[j - 1]); --j) {
+						x[j] = x[j - 1];
+					}
+					x[j] = v;
+				}
+			}
+
+			return e;
+		}
+	}
+
+	// Stable adaptive merge sort of [x, x + n) with comparison lt.
+	template<class T, class C>
+	inline void merge_sort(T* x, size_t n, C lt)
+	{
+		if (n < 2) {
+			return;
+		}
+
+		pool_vector<T> buf(n / 2 + 1);
+		std::vector<sort_::run> stack;
+
+		// merge the top two runs of the stack
+		auto collapse = [&]() {
+			sort_::run r = stack.back();
+			stack.pop_back();
+			sort_::run& l = stack.back();
+			T* x0 = x + l.b;
+			// copy the shorter side into the buffer
+			if (l.n <= r.n) {
+				sort_::merge(x0, l.n, r.n, buf.data(), lt);
+			}
+			else {
+				// merge reversed with reversed comparison
+				std::reverse(x0, x0 + l.n + r.n);
+				auto gt = [&lt](const T& a, const T& b) { return lt(b, a); };
+				sort_::merge(x0, r.n, l.n, buf.data(), gt);
+				std::reverse(x0, x0 + l.n + r.n);
+			}
+			l.n += r.n;
+		};
+
+		size_t b = 0;
+		size_t e = sort_::next_run(x, b, n, lt);
+		stack.push_back({ b, e - b, 0 });
+		while (e < n) {
+			size_t e2 = sort_::next_run(x, e, n, lt);
+			unsigned p = sort_::power(stack.back().b, stack.back().n, e2 - e, n);
+			while (stack.size() > 1 && stack[stack.size() - 2].p > p) {
+				collapse();
+			}
+			stack.back().p = p;
+			stack.push_back({ e, e2 - e, 0 });
+			e = e2;
+		}
+		while (stack.size() > 1) {
+			collapse();
+		}
+	}
+
+	// Fewer of the number of descents and strict ascents of [x, x + n).
+	template<class T, class C>
+	inline size_t presorted(const T* x, size_t n, C lt)
+	{
+		size_t d = 0, a = 0;
+
+		for (size_t i = 1; i < n; ++i) {
+			d += lt(x[i], x[i - 1]);
+			a += lt(x[i - 1], x[i]);
+		}
+
+		return std::min(d, a);
+	}
+
+	// Sort using the adaptive merge sort if x is nearly sorted or reversed, otherwise std::sort.
+	template<class T, class C = std::less<T>>
+	inline void sort(T* x, size_t n, C lt = C{})
+	{
+		if (presorted(x, n, lt) * sort_presorted < n) {
+			merge_sort(x, n, lt);
+		}
+		else {
+			std::sort(x, x + n, lt);
+		}
+	}
+
+	// Sort each row of the r x c row-major array x independently.
+	template<class T, class C = std::less<T>>
+	inline void sort_rows(size_t r, size_t c, T* x, C lt = C{})
+	{
+		parallel_for(r, [=](size_t i) {
+			if (c <= sort_network) {
+				sort_::network(x + i * c, c, lt);
+			}
+			else {
+				sort(x + i * c, c, lt);
+			}
+		}, std::max<size_t>(1, sort_block / std::max<size_t>(c, 1)));
+	}
+
+	// Sort each column of the r x c row-major array x independently.
+	template<class T, class C = std::less<T>>
+	inline void sort_columns(size_t r, size_t c, T* x, C lt = C{})
+	{
+		parallel_for(c, [=](size_t j) {
+			pool_vector<T> y(r);
+			for (size_t i = 0; i < r; ++i) {
+				y[i] = x[i * c + j];
+			}
+			if (r <= sort_network) {
+				sort_::network(y.data(), r, lt);
+			}
+			else {
+				sort(y.data(), r, lt);
+			}
+			for (size_t i = 0; i < r; ++i) {
+				x[i * c + j] = y[i];
+			}
+		}, std::max<size_t>(1, sort_block / std::max<size_t>(r, 1)));
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int sort_test()
+	{
+		{
+			assert(1 == sort_::power(0, 1, 1, 2));
+			double x[] = { 3, 1, 2 };
+			merge_sort(x, 3, std::less<double>{});
+			assert(x[0] == 1 && x[1] == 2 && x[2] == 3);
+		}
+		{
+			size_t minrun = sort_minrun;
+			sort_minrun = 4;
+			std::vector<std::vector<double>> xs;
+			size_t n = 1000;
+			std::vector<double> x(n);
+			// random
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = double((i * 7919) % 1009);
+			}
+			xs.push_back(x);
+			// nearly sorted
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = double(i);
+			}
+			std::swap(x[10], x[500]);
+			std::swap(x[900], x[20]);
+			xs.push_back(x);
+			// reversed
+			std::reverse(x.begin(), x.end());
+			xs.push_back(x);
+			// sorted with appended items
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = i < n - 50 ? double(i) : double((i * 31) % 997);
+			}
+			xs.push_back(x);
+			// many ties
+			for (size_t i = 0; i < n; ++i) {
+				x[i] = double((i * 13) % 5);
+			}
+			xs.push_back(x);
+
+			for (const auto& xi : xs) {
+				std::vector<double> y(xi), z(xi);
+				merge_sort(y.data(), n, std::less<double>{});
+				std::sort(z.begin(), z.end());
+				assert(y == z);
+				y = xi;
+				sort(y.data(), n);
+				assert(y == z);
+				y = xi;
+				merge_sort(y.data(), n, std::greater<double>{});
+				std::reverse(z.begin(), z.end());
+				assert(y == z);
+			}
+			sort_minrun = minrun;
+		}
+		{
+			// stable
+			std::pair<int, int> x[] = { {2, 0}, {1, 1}, {2, 2}, {1, 3}, {0, 4}, {2, 5}, {1, 6} };
+			auto lt = [](const auto& a, const auto& b) { return a.first < b.first; };
+			size_t minrun = sort_minrun;
+			sort_minrun = 1;
+			merge_sort(x, 7, lt);
+			sort_minrun = minrun;
+			for (size_t i = 1; i < 7; ++i) {
+				assert(x[i - 1].first < x[i].first || (x[i - 1].first == x[i].first && x[i - 1].second < x[i].second));
+			}
+		}
+
+		{
+			double x[] = { 3, 1, 2, 0, 5, 4, 4, 5, 6, 1, 1, 0 };
+			sort_rows(4, 3, x);
+			double y[] = { 1, 2, 3, 0, 4, 5, 4, 5, 6, 0, 1, 1 };
+			assert(std::equal(x, x + 12, y));
+			sort_columns(4, 3, x, std::greater<double>{});
+			double z[] = { 4, 5, 6, 1, 4, 5, 0, 2, 3, 0, 1, 1 };
+			assert(std::equal(x, x + 12, z));
+		}
+		{
+			// network and merge sort segments
+			size_t r = 50, c = 40;
+			std::vector<double> x(r * c), y;
+			for (size_t i = 0; i < x.size(); ++i) {
+				x[i] = double((i * 7919) % 101);
+			}
+			y = x;
+			sort_rows(r, c, x.data());
+			for (size_t i = 0; i < r; ++i) {
+				std::sort(y.begin() + i * c, y.begin() + (i + 1) * c);
+			}
+			assert(x == y);
+			sort_columns(c, r, x.data());
+			sort_columns(c, r, y.data(), [](double a, double b) { return a < b; });
+			assert(x == y);
+		}
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
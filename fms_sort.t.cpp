@@ -0,0 +1,6 @@
+// fms_sort.t.cpp - adaptive sort tests
+#include "fms_sort.h"
+
+#ifdef _DEBUG
+int fms_sort_test = fms::sort_test();
+#endif // _DEBUG
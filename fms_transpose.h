@@ -0,0 +1,149 @@
+// fms_transpose.h - matrix transpose
+#pragma once
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "fms_parallel.h"
+
+namespace fms {
+
+	inline const char transpose_doc[] = R"xyzyx(
+The <em>transpose</em> of an r x c row-major matrix is the c x r matrix having
+element (j, i) equal to element (i, j) of the original matrix.
+)xyzyx";
+
+	// side of tiles small enough that source and destination fit in L1
+	inline size_t transpose_tile = 32;
+
+	namespace transpose_ {
+
+		// b(j, i) = a(i, j) for i in [i0, i1) and j in [j0, j1) where a is r x c
+		inline void tile(size_t r, size_t c, const double* a, double* b, size_t i0, size_t i1, size_t j0, size_t j1)
+		{
+			for (size_t j = j0; j < j1; ++j) {
+				for (size_t i = i0; i < i1; ++i) {
+					b[j * r + i] = a[i * c + j];
+				}
+			}
+		}
+
+		// cache oblivious: split the longer side until a tile remains
+		inline void recurse(size_t r, size_t c, const double* a, double* b, size_t i0, size_t i1, size_t j0, size_t j1)
+		{
+			size_t di = i1 - i0;
+			size_t dj = j1 - j0;
+
+			if (di <= transpose_tile && dj <= transpose_tile) {
+				tile(r, c, a, b, i0, i1, j0, j1);
+			}
+			else if (di >= dj) {
+				recurse(r, c, a, b, i0, i0 + di / 2, j0, j1);
+				recurse(r, c, a, b, i0 + di / 2, i1, j0, j1);
+			}
+			else {
+				recurse(r, c, a, b, i0, i1, j0, j0 + dj / 2);
+				recurse(r, c, a, b, i0, i1, j0 + dj / 2, j1);
+			}
+		}
+
+		// swap tile (i, j) with the transpose of tile (j, i) in an n x n matrix
+		inline void swap_tile(size_t n, double* a, size_t i0, size_t i1, size_t j0, size_t j1)
+		{
+			for (size_t i = i0; i < i1; ++i) {
+				for (size_t j = (i0 == j0 ? i + 1 : j0); j < j1; ++j) {
+					std::swap(a[i * n + j], a[j * n + i]);
+				}
+			}
+		}
+	}
+
+	// b = a' where a is r x c and b is c x r
+	inline void transpose(size_t r, size_t c, const double* a, double* b)
+	{
+		// columns of a in each band, bands write disjoint rows of b
+		const size_t w = 8 * transpose_tile;
+
+		parallel_for((c + w - 1) / w, [=](size_t k) {
+			transpose_::recurse(r, c, a, b, 0, r, k * w, std::min(c, (k + 1) * w));
+		});
+	}
+
+	// In place transpose of r x c matrix a.
+	// Square matrices swap tiles across the diagonal, otherwise
+	// elements are moved along permutation cycles using r * c bits of extra memory.
+	inline void transpose(size_t r, size_t c, double* a)
+	{
+		if (r <= 1 || c <= 1) {
+			return; // same memory layout
+		}
+
+		if (r == c) {
+			const size_t t = transpose_tile;
+
+			parallel_for((r + t - 1) / t, [=](size_t k) {
+				size_t i0 = k * t, i1 = std::min(r, i0 + t);
+				for (size_t j0 = i0; j0 < r; j0 += t) {
+					transpose_::swap_tile(r, a, i0, i1, j0, std::min(r, j0 + t));
+				}
+			});
+
+			return;
+		}
+
+		// element at k moves to k * r mod (n - 1), first and last are fixed
+		const size_t n1 = r * c - 1;
+		std::vector<bool> done(n1);
+
+		for (size_t k = 1; k < n1; ++k) {
+			if (!done[k]) {
+				double t = a[k];
+				size_t p = k;
+				do {
+					p = (p * r) % n1;
+					std::swap(t, a[p]);
+					done[p] = true;
+				} while (p != k);
+			}
+		}
+	}
+
+#ifdef _DEBUG
+#include <cassert>
+
+	inline int transpose_test()
+	{
+		size_t tile = transpose_tile;
+		transpose_tile = 4;
+
+		for (auto [r, c] : { std::pair<size_t, size_t>{1, 5}, {3, 3}, {5, 2}, {17, 17}, {13, 40}, {40, 13} }) {
+			std::vector<double> a(r * c), b(r * c), d(r * c);
+			for (size_t i = 0; i < r * c; ++i) {
+				a[i] = double(i);
+			}
+			for (size_t i = 0; i < r; ++i) {
+				for (size_t j = 0; j < c; ++j) {
+					d[j * r + i] = a[i * c + j];
+				}
+			}
+
+			transpose(r, c, a.data(), b.data());
+			assert(b == d);
+
+			transpose(r, c, a.data());
+			assert(a == d);
+
+			transpose(c, r, a.data(), b.data());
+			transpose(c, r, a.data());
+			assert(a == b);
+			for (size_t i = 0; i < r * c; ++i) {
+				assert(a[i] == double(i));
+			}
+		}
+
+		transpose_tile = tile;
+
+		return 0;
+	}
+
+#endif // _DEBUG
+}
@@ -0,0 +1,6 @@
+// fms_transpose.t.cpp - transpose tests
+#include "fms_transpose.h"
+
+#ifdef _DEBUG
+int fms_transpose_test = fms::transpose_test();
+#endif // _DEBUG
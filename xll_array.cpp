@@ -1,8 +1,12 @@
 // xll_array.cpp - Array functions
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <limits>
 #include <numeric>
 #include "xll_array.h"
 #include "fms_iterable.h"
+#include "fms_parallel.h"
 
 #ifdef _DEBUG
 //int fms_iterable_iota_test_ = fms::iterable::iota_test();
@@ -17,6 +21,27 @@
 
 using namespace xll;
 
+// Join the worker threads of the shared scheduler before the add-in is unloaded.
+// If the close is cancelled they start again on the next parallel loop.
+int xll_array_close()
+{
+	fms::scheduler::instance().shutdown();
+
+	return TRUE;
+}
+Auto<Close> xac_array_close(xll_array_close);
+
+#ifdef _DEBUG
+// Threads cannot start under the loader lock so the scheduler is tested after open.
+int xll_array_parallel_test()
+{
+	fms::parallel_test();
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_parallel_test(xll_array_parallel_test);
+#endif // _DEBUG
+
 AddIn xai_array_(
 	Function(XLL_HANDLEX, "xll_array_", "\\ARRAY")
 	.Arguments({
@@ -47,10 +72,12 @@ HANDLEX WINAPI xll_array_(const _FP12* pa)
 		if (_pa) {
 			handle<FPX> h_(new FPX(*_pa));
 			ensure(h_);
+			touch(h_.ptr());
 			h = h_.get();
 		}
 		else {
 			handle<FPX> h_(new FPX(*pa));
+			touch(h_.ptr());
 			h = h_.get();
 		}
 	}
@@ -75,6 +102,8 @@ AddIn xai_array_get(
 Retrieve an in-memory array created by
 <code>\ARRAY</code>. By default the handle is checked to
 ensure the array was created by a previous call to <code>\ARRAY</code>.
+A handle to a virtual sequence created by <code>\ARRAY.SEQUENCE</code>
+returns the materialized sequence.
 )")
 .SeeAlso({ "\\ARRAY" })
 );
@@ -88,6 +117,15 @@ _FP12* WINAPI xll_array_get(HANDLEX h)
 		if (h_) {
 			pa = h_->get();
 		}
+		else {
+			handle<fms::sequence> s_(h);
+			if (s_) {
+				static FPX a;
+				a.resize(static_cast<int>(s_->count), 1);
+				fms::materialize(*s_, a.array(), s_->count);
+				pa = a.get();
+			}
+		}
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
@@ -110,9 +148,12 @@ AddIn xai_array_resize(
 	.Category(CATEGORY)
 	.Documentation(R"(
 Resize array to <code>rows</code> and <code>columns</code>.
+Elements keep their row-major order so the first <code>rows</code> times <code>columns</code>
+elements are unchanged. If the array grows the new elements are zero.
 If <code>array</code> is a handle this function resizes the in-memory array and
 returns its handle, otherwise the resized array is returned.
 )")
+.SeeAlso({ "ARRAY.TRANSPOSE" })
 );
 _FP12* WINAPI xll_array_resize(_FP12* pa, LONG r, LONG c)
 {
@@ -120,20 +161,43 @@ _FP12* WINAPI xll_array_resize(_FP12* pa, LONG r, LONG c)
 	static FPX a;
 
 	try {
-		a = *pa;
+		ensure((r > 0 && c > 0) || !"ARRAY.RESIZE: rows and columns must be positive");
+		const int64_t rc = static_cast<int64_t>(r) * c;
+		ensure(rc <= std::numeric_limits<int>::max() || !"ARRAY.RESIZE: too many elements");
+
 		FPX* _a = ptr(pa);
 		if (_a) {
+			int n = _a->size();
 			_a->resize(r, c);
+			if (_a->size() > n) {
+				std::fill(_a->array() + n, _a->array() + _a->size(), 0.);
+			}
+
+			return pa;
 		}
-		else {
-			a.resize(r,c);
+
+		int n = size(*pa);
+		if (rc <= n) {
+			// shrink in place
+			pa->rows = r;
+			pa->columns = c;
+
+			return pa;
 		}
+
+		a = *pa;
+		a.resize(r, c);
+		std::fill(a.array() + n, a.array() + a.size(), 0.);
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
+
+		return nullptr;
 	}
 	catch (...) {
 		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
 	}
 
 	return a.get();
@@ -150,16 +214,20 @@ AddIn xai_array_rows(
 Return the number of rows of an array.
 )")
 );
-LONG WINAPI xll_array_rows(_FP12* pa)
+LONG WINAPI xll_array_rows(const _FP12* pa)
 {
 #pragma XLLEXPORT
 	LONG r = 0;
 
 	try {
-		FPX* _a = ptr(pa);
+		const FPX* _a = ptr(pa);
+		const fms::sequence* _s = seq(pa);
 		if (_a) {
 			r = _a->rows();
 		}
+		else if (_s) {
+			r = static_cast<LONG>(_s->count);
+		}
 		else {
 			r = pa->rows;
 		}
@@ -185,16 +253,20 @@ AddIn xai_array_columns(
 Return the number of columns of an array.
 )")
 );
-LONG WINAPI xll_array_columns(_FP12* pa)
+LONG WINAPI xll_array_columns(const _FP12* pa)
 {
 #pragma XLLEXPORT
 	LONG c = 0;
 
 	try {
-		FPX* _a = ptr(pa);
+		const FPX* _a = ptr(pa);
+		const fms::sequence* _s = seq(pa);
 		if (_a) {
 			c = _a->columns();
 		}
+		else if (_s) {
+			c = 1;
+		}
 		else {
 			c = pa->columns;
 		}
@@ -220,16 +292,20 @@ AddIn xai_array_size(
 Return the number of rows times the number of columns of an array.
 )")
 );
-LONG WINAPI xll_array_size(_FP12* pa)
+LONG WINAPI xll_array_size(const _FP12* pa)
 {
 #pragma XLLEXPORT
 	LONG c = 0;
 
 	try {
-		FPX* _a = ptr(pa);
+		const FPX* _a = ptr(pa);
+		const fms::sequence* _s = seq(pa);
 		if (_a) {
 			c = _a->size();
 		}
+		else if (_s) {
+			c = static_cast<LONG>(_s->count);
+		}
 		else {
 			c = size(*pa);
 		}
@@ -264,6 +340,7 @@ HANDLEX WINAPI xll_array_flip(HANDLEX h, int i)
 			i = std::clamp(i, 0, h_->size() - 1);
 			double xi = h_->operator[](i);
 			h_->operator[](i) = 1 - xi;
+			touch(h_.ptr());
 			h_ = h_.get();
 		}
 	}
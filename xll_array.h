@@ -1,5 +1,8 @@
 // xll_array.h - array functions
 #pragma once
+#include "fms_grade.h"
+#include "fms_memo.h"
+#include "fms_sequence.h"
 #include "xll24/include/xll.h"
 
 #ifndef CATEGORY
@@ -8,12 +11,75 @@
 
 namespace xll {
 
+	// version of an in-memory array, changed by every mutation
+	inline uint64_t version(const FPX* a)
+	{
+		return fms::versions::instance().get(a);
+	}
+	// record a mutation or creation of an in-memory array
+	inline void touch(const FPX* a)
+	{
+		auto& v = fms::versions::instance();
+
+		v.bump(a);
+		// forget arrays whose handles have been deleted
+		v.sweep([](const void* p) {
+			return !handle<FPX>(to_handle<FPX>(const_cast<FPX*>(static_cast<const FPX*>(p))));
+		});
+	}
+
+	// most bytes of results cached by memoized functions
+	inline size_t memo_budget = size_t(1) << 28;
+
+	// results of memoized functions
+	inline fms::memo<FPX>& memo()
+	{
+		static fms::memo<FPX> m(memo_budget);
+
+		return m;
+	}
+
+	// true if a has not changed since record(key, a)
+	inline bool unchanged(const std::string& key, const FPX* a)
+	{
+		auto m = memo().find(key);
+
+		return m && (*m)[0] == static_cast<double>(version(a));
+	}
+	// remember the version of a after an idempotent in-place operation
+	inline void record(const std::string& key, const FPX* a)
+	{
+		FPX v(1, 1);
+		v[0] = static_cast<double>(version(a));
+		memo().insert(key, std::make_shared<const FPX>(v), sizeof(double));
+	}
+
+	// Cached stable increasing grade of the in-memory array a of handle h.
+	// Return null if not cached and compute is false.
+	inline std::shared_ptr<const FPX> permutation(HANDLEX h, const FPX* a, bool compute = true)
+	{
+		std::string key = fms::memo_key("ARRAY.PERMUTATION", { h, static_cast<double>(version(a)) });
+
+		auto p = memo().find(key);
+		if (!p && compute) {
+			auto p_ = std::make_shared<FPX>(a->size(), 1);
+			fms::grade(a->size(), a->array(), p_->array());
+			memo().insert(key, p_, p_->size() * sizeof(double));
+			p = p_;
+		}
+
+		return p;
+	}
+
 	// underlying pointer if 1 x 1 and handle to FPX
+	// The array may be modified so its version is changed.
 	inline FPX* ptr(_FP12* pa)
 	{
 		if (size(*pa) == 1) {
 			handle<FPX> a_(pa->array[0]);
 			if (a_) {
+				touch(a_.ptr());
+
 				return a_.ptr();
 			}
 		}
@@ -33,6 +99,19 @@ namespace xll {
 		return nullptr;
 	}
 
+	// underlying sequence if 1 x 1 and handle to a virtual sequence
+	inline const fms::sequence* seq(const _FP12* pa)
+	{
+		if (size(*pa) == 1) {
+			handle<fms::sequence> s_(pa->array[0]);
+			if (s_) {
+				return s_.ptr();
+			}
+		}
+
+		return nullptr;
+	}
+
 	_FP12* take(_FP12* pa, int n)
 	{
 		if (pa) {
@@ -1,21 +1,9 @@
 // xll_array_acf.cpp - Auto covariance/correlation
-#include <numeric>
+#include "fms_acf.h"
 #include "xll_array.h"
 
 using namespace xll;
 
-// covariance
-double cov(unsigned n, const double* x, const double* y, double x_, double y_)
-{
-	double c = 0;
-
-	for (unsigned i = 0; i < n; ++i) {
-		c += (x[i] - x_) * (y[i] - y_);
-	}
-
-	return c / n;
-}
-
 AddIn xai_array_acf(
 	Function(XLL_FP, "xll_array_acf", "ARRAY.ACF")
 	.Arguments({
@@ -25,46 +13,32 @@ AddIn xai_array_acf(
 	.FunctionHelp("Return auto covariance of the array.")
 	.Category(CATEGORY)
 	.Documentation(R"xyzyx(
+If <code>array</code> is a handle the result is cached until the in-memory array changes.
 )xyzyx")
 );
-_FP12* WINAPI xll_array_acf(_FP12* pa, BOOL corr)
+_FP12* WINAPI xll_array_acf(const _FP12* pa, BOOL corr)
 {
 #pragma XLLEXPORT
 	static FPX acf;
 
 	try {
-		FPX* _a = ptr(pa);
+		const FPX* _a = ptr(pa);
+		std::string key;
 		if (_a) {
+			key = fms::memo_key("ARRAY.ACF", { pa->array[0], static_cast<double>(version(_a)), static_cast<double>(corr) });
+			if (auto m = memo().find(key)) {
+				acf = *m;
+
+				return acf.get();
+			}
 			pa = _a->get();
 		}
 
 		acf.resize(pa->rows, pa->columns);
-		unsigned n = acf.size();
+		fms::acf(acf.size(), pa->array, acf.array(), corr);
 
-		// (a[0] + ... a[n - i - 1])/(n - i)
-		double ai_ = std::accumulate(begin(*pa), end(*pa), 0.) / n;
-		// (a[i] + ... + a[n-1])/(n - i)
-		double _ai = ai_;
-
-		acf[0] = cov(n, &pa->array[0], &pa->array[0], ai_, _ai);
-
-		// cov(a, a + i)
-		for (unsigned i = 1; i < n; ++i) {
-			ai_ *= n - i + 1;
-			ai_ -= pa->array[n - i];
-			ai_ /= (n - i);
-
-			_ai *= n - i + 1;
-			_ai -= pa->array[i - 1];
-			_ai /= (n - i);
-
-			acf[i] = cov(n - i, &pa->array[0], &pa->array[i], ai_, _ai);
-			if (corr) {
-				acf[i] /= acf[0];
-			}
-		}
-		if (corr) {
-			acf[0] = 1;
+		if (_a) {
+			memo().insert(key, std::make_shared<const FPX>(acf), acf.size() * sizeof(double));
 		}
 	}
 	catch (const std::exception& ex) {
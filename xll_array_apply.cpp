@@ -12,7 +12,10 @@ AddIn xai_array_apply(
 		})
 		.FunctionHelp("Apply a function to each element of an array.")
 	.Category(CATEGORY)
-	.Documentation(R"()")
+	.Documentation(R"(
+If <code>array</code> is a handle to a virtual sequence then the
+function is applied to its items without materializing the sequence.
+)")
 );
 _FP12* WINAPI xll_array_apply(LPOPER pf, _FP12* pa)
 {
@@ -22,6 +25,17 @@ _FP12* WINAPI xll_array_apply(LPOPER pf, _FP12* pa)
 		pa = _a->get();
 	}
 
+	const fms::sequence* _s = seq(pa);
+	if (_s) {
+		static FPX a;
+		a.resize(static_cast<int>(_s->count), 1);
+		for (size_t i = 0; i < _s->count; ++i) {
+			a[static_cast<int>(i)] = Num(Excel(xlUDF, *pf, (*_s)[i]));
+		}
+
+		return a.get();
+	}
+
 	for (int i = 0; i < size(*pa); ++i) {
 		pa->array[i] = Num(Excel(xlUDF, *pf, pa->array[i]));
 	}
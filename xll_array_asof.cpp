@@ -0,0 +1,157 @@
+// xll_array_asof.cpp - As-of join of time-indexed arrays
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "fms_asof.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_asof(
+	Function(XLL_FP, "xll_array_asof", "ARRAY.ASOF")
+	.Arguments({
+		Arg(XLL_FP, "left_times", "is an increasing array or handle to an array of times."),
+		Arg(XLL_FP, "right_times", "is an increasing array or handle to an array of times."),
+		Arg(XLL_FP, "right_values", "is an array or handle to an array with one row or item per right time."),
+		Arg(XLL_LONG, "_direction", "is an optional direction: 0 for backward, 1 for forward, 2 for nearest. Default is 0."),
+		Arg(XLL_LPOPER, "_tolerance", "is an optional largest distance between matched times. Default is no limit."),
+		})
+	.FunctionHelp("Return the right values as of each left time.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+For each time in <code>left_times</code> find the last time in <code>right_times</code>
+that is not after it when <code>_direction</code> is 0, the first time that is not before it
+when <code>_direction</code> is 1, or the closest time when <code>_direction</code> is 2.
+Return the row of <code>right_values</code> for the matching time, or NaN if there is no
+match or the times are further apart than <code>_tolerance</code>.
+If <code>_tolerance</code> is missing there is no limit and if it is 0 only equal times match.
+This is like <code>VLOOKUP</code> with approximate match except all times are joined
+in one linear merge instead of a search per time.
+<p>
+If <code>right_values</code> has one row per right time the result has one row per left time
+and the same columns as <code>right_values</code>, otherwise it is one column.
+Blocks of left times are joined in parallel.
+)xyzyx")
+.SeeAlso({ "ARRAY.MERGE", "ARRAY.INDEX" })
+);
+_FP12* WINAPI xll_array_asof(const _FP12* pt, const _FP12* ps, const _FP12* pv, LONG dir, LPOPER ptol)
+{
+#pragma XLLEXPORT
+	static FPX a;
+
+	try {
+		if (const FPX* _t = ptr(pt)) {
+			pt = _t->get();
+		}
+		if (const FPX* _s = ptr(ps)) {
+			ps = _s->get();
+		}
+		if (const FPX* _v = ptr(pv)) {
+			pv = _v->get();
+		}
+
+		ensure((0 <= dir && dir <= 2) || !"ARRAY.ASOF: _direction must be 0, 1, or 2");
+		double tol = INFINITY;
+		if (!isMissing(*ptol)) {
+			ensure(isNum(*ptol) || !"ARRAY.ASOF: _tolerance must be a number");
+			tol = ptol->val.num;
+			ensure(tol >= 0 || !"ARRAY.ASOF: _tolerance must be non-negative");
+		}
+
+		size_t n = size(*pt);
+		size_t m = size(*ps);
+		ensure(std::is_sorted(pt->array, pt->array + n) || !"ARRAY.ASOF: left_times must be increasing");
+		ensure(std::is_sorted(ps->array, ps->array + m) || !"ARRAY.ASOF: right_times must be increasing");
+
+		size_t w = 1;
+		if (static_cast<size_t>(pv->rows) == m) {
+			w = pv->columns;
+		}
+		else {
+			ensure(static_cast<size_t>(size(*pv)) == m || !"ARRAY.ASOF: right_values must have one row or item per right time");
+		}
+
+		std::vector<double> j(n);
+		fms::asof(n, pt->array, m, ps->array, j.data(), static_cast<fms::asof_direction>(dir), tol);
+
+		a.resize(static_cast<int>(n), static_cast<int>(w));
+		for (size_t i = 0; i < n; ++i) {
+			for (size_t k = 0; k < w; ++k) {
+				a[static_cast<int>(i * w + k)] = std::isnan(j[i]) ? NAN : pv->array[static_cast<size_t>(j[i]) * w + k];
+			}
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return a.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_asof_test()
+{
+	OPER none;
+	none.xltype = xltypeMissing;
+	{
+		FPX t(3, 1), s(2, 1), v(2, 2);
+		t[0] = 0;
+		t[1] = 1.5;
+		t[2] = 3;
+		s[0] = 1;
+		s[1] = 2;
+		v[0] = 10;
+		v[1] = 11;
+		v[2] = 20;
+		v[3] = 21;
+		_FP12* pa = xll_array_asof(t.get(), s.get(), v.get(), 0, &none);
+		ensure(pa->rows == 3);
+		ensure(pa->columns == 2);
+		ensure(std::isnan(pa->array[0]));
+		ensure(pa->array[2] == 10);
+		ensure(pa->array[3] == 11);
+		ensure(pa->array[4] == 20);
+
+		pa = xll_array_asof(t.get(), s.get(), v.get(), 1, &none);
+		ensure(pa->array[0] == 10);
+		ensure(pa->array[2] == 20);
+		ensure(std::isnan(pa->array[4]));
+
+		// exact match
+		OPER zero(0.);
+		t[1] = 2;
+		pa = xll_array_asof(t.get(), s.get(), v.get(), 0, &zero);
+		ensure(std::isnan(pa->array[0]));
+		ensure(pa->array[2] == 20);
+		ensure(std::isnan(pa->array[4]));
+	}
+	{
+		// one right time with a row of values
+		FPX t(2, 1), s(1, 1), v(1, 3);
+		t[0] = 0;
+		t[1] = 1;
+		s[0] = 1;
+		v[0] = 10;
+		v[1] = 11;
+		v[2] = 12;
+		_FP12* pa = xll_array_asof(t.get(), s.get(), v.get(), 0, &none);
+		ensure(pa->rows == 2);
+		ensure(pa->columns == 3);
+		ensure(std::isnan(pa->array[0]));
+		ensure(pa->array[3] == 10);
+		ensure(pa->array[5] == 12);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_asof_test(xll_array_asof_test);
+
+#endif // _DEBUG
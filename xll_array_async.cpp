@@ -0,0 +1,385 @@
+// xll_array_async.cpp - Asynchronous array operations
+#include <algorithm>
+#include "fms_acf.h"
+#include "fms_async.h"
+#include "fms_cov.h"
+#include "fms_sort.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+// seconds between checks for finished jobs
+static const double poll_seconds = 0.5;
+// time of the scheduled check, 0 if none
+static double poll_time = 0;
+// jobs finished at the last check
+static size_t poll_completed = 0;
+
+// Worksheet functions cannot call commands so a timer on the main thread
+// checks for finished jobs while any are outstanding.
+static void poll_schedule()
+{
+	poll_time = Num(Excel(xlfNow)) + poll_seconds / 86400;
+	Excel(xlcOnTime, OPER(poll_time), OPER("ARRAY.ASYNC.POLL"));
+}
+
+// Start the timer after a calculation that posted jobs.
+AddIn xai_array_async_start(Macro("xll_array_async_start", "ARRAY.ASYNC.START"));
+int WINAPI xll_array_async_start()
+{
+#pragma XLLEXPORT
+	try {
+		if (poll_time == 0 && fms::background::instance().outstanding() > 0) {
+			poll_schedule();
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return FALSE;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+// Recalculate the active sheet when jobs have finished and stop when none are outstanding.
+AddIn xai_array_async_poll(Macro("xll_array_async_poll", "ARRAY.ASYNC.POLL"));
+int WINAPI xll_array_async_poll()
+{
+#pragma XLLEXPORT
+	try {
+		auto& b = fms::background::instance();
+		poll_time = 0;
+		if (b.outstanding() > 0) {
+			poll_schedule();
+		}
+		size_t n = b.completed();
+		if (n != poll_completed) {
+			poll_completed = n;
+			Excel(xlcCalculateDocument);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return FALSE;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+int xll_array_async_open()
+{
+	try {
+		Excel(xlEventRegister, OPER("ARRAY.ASYNC.START"), OPER(xleventCalculationEnded));
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_async_open(xll_array_async_open);
+
+// Cancel the timer and stop the background thread before the add-in is unloaded.
+int xll_array_async_close()
+{
+	try {
+		Excel(xlEventRegister, OPER(), OPER(xleventCalculationEnded));
+		if (poll_time != 0) {
+			Excel(xlcOnTime, OPER(poll_time), OPER("ARRAY.ASYNC.POLL"), OPER(poll_time), OPER(false));
+			poll_time = 0;
+		}
+	}
+	catch (...) {
+		// nothing was registered or scheduled
+	}
+	fms::background::instance().shutdown();
+
+	return TRUE;
+}
+Auto<Close> xac_array_async_close(xll_array_async_close);
+
+// Pending result of a background job. Deleting it cancels the job.
+struct pending {
+	std::shared_ptr<fms::async_result<FPX>> result;
+
+	pending(std::shared_ptr<fms::async_result<FPX>> result)
+		: result(result)
+	{ }
+	~pending()
+	{
+		result->cancel();
+	}
+};
+
+AddIn xai_array_sort_async(
+	Function(XLL_HANDLEX, "xll_array_sort_async", "\\ARRAY.SORT.ASYNC")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array to sort."),
+		Arg(XLL_BOOL, "_decreasing", "is an optional flag to sort in decreasing order. Default is FALSE."),
+		})
+	.Uncalced()
+	.FunctionHelp("Return a pending handle to array sorted in the background.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Copy <code>array</code> and sort it on a background thread like <code>ARRAY.SORT</code>.
+Return a pending handle immediately. Use <code>ARRAY.READY</code> to check if the sort is done
+and <code>ARRAY.WAIT</code> to return the sorted array. The active sheet is recalculated
+when the sort finishes so these cells pick up the result.
+If the arguments change the pending sort is cancelled.
+)xyzyx")
+	.SeeAlso({ "ARRAY.READY", "ARRAY.WAIT", "ARRAY.SORT" })
+);
+HANDLEX WINAPI xll_array_sort_async(const _FP12* pa, BOOL decreasing)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		const FPX* _a = ptr(pa);
+		FPX a(_a ? *_a->get() : *pa);
+
+		handle<pending> h_(new pending(fms::async<FPX>([a, decreasing](const auto& token) mutable {
+			if (!token.cancelled()) {
+				if (decreasing) {
+					fms::sort(a.array(), a.size(), std::greater<double>{});
+				}
+				else {
+					fms::sort(a.array(), a.size());
+				}
+			}
+
+			return a;
+		})));
+		h = h_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return h;
+}
+
+AddIn xai_array_cov_async(
+	Function(XLL_HANDLEX, "xll_array_cov_async", "\\ARRAY.COV.ASYNC")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_BOOL, "_pairwise", "is an optional flag to ignore NaN pairwise. Default is false."),
+		Arg(XLL_BOOL, "_correlation", "is an optional flag to return correlations. Default is false."),
+		})
+	.Uncalced()
+	.FunctionHelp("Return a pending handle to the covariance matrix of the columns of array.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Copy <code>array</code> and compute <code>ARRAY.COV</code> or <code>ARRAY.CORR</code>
+on a background thread. Return a pending handle immediately.
+The active sheet is recalculated when the computation finishes.
+If the arguments change the pending computation is cancelled.
+)xyzyx")
+	.SeeAlso({ "ARRAY.READY", "ARRAY.WAIT", "ARRAY.COV", "ARRAY.CORR" })
+);
+HANDLEX WINAPI xll_array_cov_async(const _FP12* pa, BOOL pairwise, BOOL corr)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		const FPX* _a = ptr(pa);
+		FPX a(_a ? *_a->get() : *pa);
+
+		handle<pending> h_(new pending(fms::async<FPX>([a, pairwise, corr](const auto& token) {
+			size_t n = a.rows();
+			size_t c = a.columns();
+			FPX s(static_cast<int>(c), static_cast<int>(c));
+			if (!token.cancelled()) {
+				if (corr) {
+					fms::correlation(n, c, a.get()->array, s.array(), nullptr, pairwise, token.cancellation());
+				}
+				else {
+					fms::covariance(n, c, a.get()->array, s.array(), nullptr, pairwise, token.cancellation());
+				}
+			}
+
+			return s;
+		})));
+		h = h_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return h;
+}
+
+AddIn xai_array_acf_async(
+	Function(XLL_HANDLEX, "xll_array_acf_async", "\\ARRAY.ACF.ASYNC")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_BOOL, "_correlation", "is an optional flag indicating correlations should be returned."),
+		})
+	.Uncalced()
+	.FunctionHelp("Return a pending handle to the auto covariance of array.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Copy <code>array</code> and compute <code>ARRAY.ACF</code> on a background thread.
+Return a pending handle immediately.
+The active sheet is recalculated when the computation finishes.
+If the arguments change the pending computation is cancelled.
+)xyzyx")
+	.SeeAlso({ "ARRAY.READY", "ARRAY.WAIT", "ARRAY.ACF" })
+);
+HANDLEX WINAPI xll_array_acf_async(const _FP12* pa, BOOL corr)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		const FPX* _a = ptr(pa);
+		FPX a(_a ? *_a->get() : *pa);
+
+		handle<pending> h_(new pending(fms::async<FPX>([a, corr](const auto& token) {
+			FPX y(a.rows(), a.columns());
+			if (!token.cancelled()) {
+				fms::acf(y.size(), a.array(), y.array(), corr, token.cancellation());
+			}
+
+			return y;
+		})));
+		h = h_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return h;
+}
+
+AddIn xai_array_ready(
+	Function(XLL_LONG, "xll_array_ready", "ARRAY.READY")
+	.Arguments({
+		Arg(XLL_HANDLEX, "handle", "is a pending handle."),
+		})
+	.Volatile()
+	.FunctionHelp("Return the status of a pending handle.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return 0 if the job is queued, 1 if it is running, 2 if the result is ready,
+3 if it was cancelled, and 4 if it failed. This function is volatile so
+it is updated by the recalculation that follows a finished job.
+)xyzyx")
+	.SeeAlso({ "ARRAY.WAIT" })
+);
+LONG WINAPI xll_array_ready(HANDLEX h)
+{
+#pragma XLLEXPORT
+	LONG s = -1;
+
+	try {
+		handle<pending> h_(h);
+		ensure(h_ || !"ARRAY.READY: handle must be a pending handle");
+
+		s = static_cast<LONG>(h_->result->status());
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return s;
+}
+
+AddIn xai_array_wait(
+	Function(XLL_FP, "xll_array_wait", "ARRAY.WAIT")
+	.Arguments({
+		Arg(XLL_HANDLEX, "handle", "is a pending handle."),
+		Arg(XLL_DOUBLE, "_timeout", "is an optional number of seconds to wait. Default is 0."),
+		})
+	.Volatile()
+	.FunctionHelp("Return the result of a pending handle.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return the result of the job of a pending handle.
+If the job is not done after waiting at most <code>_timeout</code> seconds
+then an error is returned. The default does not wait and never blocks recalculation.
+This function is volatile so it returns the result after the recalculation
+that follows a finished job.
+)xyzyx")
+	.SeeAlso({ "ARRAY.READY" })
+);
+_FP12* WINAPI xll_array_wait(HANDLEX h, double timeout)
+{
+#pragma XLLEXPORT
+	try {
+		handle<pending> h_(h);
+		ensure(h_ || !"ARRAY.WAIT: handle must be a pending handle");
+
+		auto& r = *h_->result;
+		auto ms = std::chrono::milliseconds(static_cast<long long>(1000 * std::max(timeout, 0.)));
+		if (!r.wait(ms)) {
+			return nullptr; // not done yet
+		}
+
+		return r.get().get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return nullptr;
+}
+
+#ifdef _DEBUG
+
+// Threads cannot start under the loader lock so fms::async_test runs after open.
+int xll_array_async_test()
+{
+	fms::async_test();
+
+	{
+		FPX a(1, 3);
+		a[0] = 3; a[1] = 1; a[2] = 2;
+		HANDLEX h = xll_array_sort_async(a.get(), FALSE);
+		_FP12* pb = xll_array_wait(h, 10);
+		ensure(pb->array[0] == 1 && pb->array[1] == 2 && pb->array[2] == 3);
+		ensure(xll_array_ready(h) == static_cast<LONG>(fms::async_status::ready));
+	}
+	{
+		FPX a(1, 3);
+		a[0] = 1; a[1] = 2; a[2] = 3;
+		HANDLEX h = xll_array_acf_async(a.get(), FALSE);
+		_FP12* pb = xll_array_wait(h, 10);
+		ensure(pb->array[1] == 0.25);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_async_test(xll_array_async_test);
+
+#endif // _DEBUG
@@ -0,0 +1,128 @@
+// xll_array_convolve.cpp - Convolution and cross-correlation of arrays
+#include "fms_convolve.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+// y = x * h or the cross-correlation of x and h
+static _FP12* xll_array_convolve_(const _FP12* px, const _FP12* ph, bool corr)
+{
+	static FPX y;
+
+	const FPX* _x = ptr(px);
+	const _FP12* x = _x ? _x->get() : px;
+	const FPX* _h = ptr(ph);
+	if (_h) {
+		ph = _h->get();
+	}
+
+	size_t n = size(*x);
+	size_t m = size(*ph);
+	int ny = static_cast<int>(n + m - 1);
+	if (x->rows == 1) {
+		y.resize(1, ny);
+	}
+	else {
+		y.resize(ny, 1);
+	}
+	if (corr) {
+		fms::xcorr(n, x->array, m, ph->array, y.array());
+	}
+	else {
+		fms::convolve(n, x->array, m, ph->array, y.array());
+	}
+
+	return y.get();
+}
+
+AddIn xai_array_convolve(
+	Function(XLL_FP, "xll_array_convolve", "ARRAY.CONVOLVE")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_FP, "kernel", "is an array or handle to an array."),
+		})
+	.FunctionHelp("Return the convolution of array and kernel.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return <code>{y0, ..., y[n + m - 2]}</code> where <code>y[k]</code> is the sum of
+<code>kernel[j] array[k - j]</code> and <code>n</code> and <code>m</code> are the sizes of
+<code>array</code> and <code>kernel</code>.
+<p>
+Short kernels are convolved directly in parallel blocks. Kernels with
+64 or more items use FFT overlap-add.
+<p>
+If <code>array</code> is a handle the in-memory array is not modified.
+)xyzyx")
+	.SeeAlso({ "ARRAY.XCORR" })
+);
+_FP12* WINAPI xll_array_convolve(const _FP12* px, const _FP12* ph)
+{
+#pragma XLLEXPORT
+	try {
+		return xll_array_convolve_(px, ph, false);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return nullptr;
+}
+
+AddIn xai_array_xcorr(
+	Function(XLL_FP, "xll_array_xcorr", "ARRAY.XCORR")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_FP, "array2", "is an array or handle to an array."),
+		})
+	.FunctionHelp("Return the cross-correlation of array and array2.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return the sum of <code>array[t + l] array2[t]</code> for lags <code>l = 1 - m, ..., n - 1</code>
+where <code>n</code> and <code>m</code> are the sizes of <code>array</code> and <code>array2</code>.
+The item at lag 0 is at index <code>m - 1</code>.
+Positive lags measure how <code>array</code> follows <code>array2</code>.
+<p>
+If <code>array</code> is a handle the in-memory array is not modified.
+)xyzyx")
+	.SeeAlso({ "ARRAY.CONVOLVE", "ARRAY.ACF" })
+);
+_FP12* WINAPI xll_array_xcorr(const _FP12* px, const _FP12* py)
+{
+#pragma XLLEXPORT
+	try {
+		return xll_array_convolve_(px, py, true);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return nullptr;
+}
+
+#ifdef _DEBUG
+
+int xll_array_convolve_test()
+{
+	{
+		FPX x(1, 3), h(1, 2);
+		x[0] = 1; x[1] = 2; x[2] = 3;
+		h[0] = 1; h[1] = 1;
+		_FP12* py = xll_array_convolve(x.get(), h.get());
+		ensure(py->rows == 1 && py->columns == 4);
+		ensure(py->array[0] == 1 && py->array[1] == 3 && py->array[2] == 5 && py->array[3] == 3);
+		h[1] = 0;
+		py = xll_array_xcorr(x.get(), h.get());
+		ensure(py->array[0] == 0 && py->array[1] == 1 && py->array[2] == 2 && py->array[3] == 3);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_convolve_test(xll_array_convolve_test);
+
+#endif // _DEBUG
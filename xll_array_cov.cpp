@@ -0,0 +1,126 @@
+// xll_array_cov.cpp - Covariance and correlation matrices of columns
+#include "fms_cov.h"
+#include "fms_ewma.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+static const char xll_array_cov_doc[] = R"xyzyx(
+Rows of <code>array</code> are observations and columns are series.
+If <code>_lambda</code> is between 0 and 1 then observations are given exponentially
+decaying weights as in <code>ARRAY.EWMA</code>, otherwise they are equally weighted
+and the sample covariance is used.
+If <code>_pairwise</code> is true then NaN observations are ignored for each pair of columns,
+otherwise any NaN in a column makes its row and column of the result NaN.
+<p>
+Columns are centered and the lower triangle of the matrix is accumulated in tiles in parallel.
+<p>
+If <code>array</code> is a handle the in-memory array is not modified.
+)xyzyx";
+
+// n x n covariance or correlation of the columns of pa
+static _FP12* xll_array_cov_(const _FP12* pa, double lambda, BOOL pairwise, bool corr)
+{
+	static FPX s;
+
+	ensure((0 <= lambda && lambda < 1) || !"ARRAY.COV: _lambda must be between 0 and 1");
+
+	const FPX* _a = ptr(pa);
+	const _FP12* x = _a ? _a->get() : pa;
+	size_t n = x->rows;
+	size_t c = x->columns;
+
+	std::vector<double> w;
+	if (lambda) {
+		w.resize(n);
+		fms::ewma_weights(n, lambda, w.data());
+	}
+
+	s.resize(static_cast<int>(c), static_cast<int>(c));
+	if (corr) {
+		fms::correlation(n, c, x->array, s.array(), lambda ? w.data() : nullptr, pairwise);
+	}
+	else {
+		fms::covariance(n, c, x->array, s.array(), lambda ? w.data() : nullptr, pairwise);
+	}
+
+	return s.get();
+}
+
+AddIn xai_array_cov(
+	Function(XLL_FP, "xll_array_cov", "ARRAY.COV")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_DOUBLE, "_lambda", "is an optional decay factor. Default is 0 for equal weights."),
+		Arg(XLL_BOOL, "_pairwise", "is an optional flag to ignore NaN pairwise. Default is false."),
+		})
+	.FunctionHelp("Return the covariance matrix of the columns of array.")
+	.Category(CATEGORY)
+	.Documentation(xll_array_cov_doc)
+	.SeeAlso({ "ARRAY.CORR", "ARRAY.EWMA" })
+);
+_FP12* WINAPI xll_array_cov(const _FP12* pa, double lambda, BOOL pairwise)
+{
+#pragma XLLEXPORT
+	try {
+		return xll_array_cov_(pa, lambda, pairwise, false);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return nullptr;
+}
+
+AddIn xai_array_corr(
+	Function(XLL_FP, "xll_array_corr", "ARRAY.CORR")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_DOUBLE, "_lambda", "is an optional decay factor. Default is 0 for equal weights."),
+		Arg(XLL_BOOL, "_pairwise", "is an optional flag to ignore NaN pairwise. Default is false."),
+		})
+	.FunctionHelp("Return the correlation matrix of the columns of array.")
+	.Category(CATEGORY)
+	.Documentation(xll_array_cov_doc)
+	.SeeAlso({ "ARRAY.COV", "ARRAY.EWMA" })
+);
+_FP12* WINAPI xll_array_corr(const _FP12* pa, double lambda, BOOL pairwise)
+{
+#pragma XLLEXPORT
+	try {
+		return xll_array_cov_(pa, lambda, pairwise, true);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return nullptr;
+}
+
+#ifdef _DEBUG
+
+int xll_array_cov_test()
+{
+	{
+		FPX a(3, 2);
+		a[0] = 1; a[1] = 2;
+		a[2] = 2; a[3] = 4;
+		a[4] = 3; a[5] = 6;
+		_FP12* ps = xll_array_cov(a.get(), 0, FALSE);
+		ensure(ps->rows == 2 && ps->columns == 2);
+		ensure(ps->array[0] == 1 && ps->array[1] == 2 && ps->array[2] == 2 && ps->array[3] == 4);
+		ps = xll_array_corr(a.get(), 0, FALSE);
+		ensure(ps->array[0] == 1 && ps->array[3] == 1);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_cov_test(xll_array_cov_test);
+
+#endif // _DEBUG
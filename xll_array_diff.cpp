@@ -1,5 +1,5 @@
 // xll_array_diff.cpp - Adjacent differences of array
-#include <numeric>
+#include "fms_diff.h"
 #include "xll_array.h"
 
 using namespace xll;
@@ -8,23 +8,53 @@ AddIn xai_array_diff(
 	Function(XLL_FP, "xll_array_diff", "ARRAY.DIFF")
 	.Arguments({
 		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_LONG, "_lag", "is an optional lag. Default is 1."),
+		Arg(XLL_LONG, "_order", "is an optional number of times to difference. Default is 1."),
+		Arg(XLL_LONG, "_mode", "is an optional mode: 0 for differences, 1 for percent returns, 2 for log returns. Default is 0."),
 		})
 	.FunctionHelp("Return adjacent differences of array.")
 	.Category(CATEGORY)
 	.Documentation(R"xyzyx(
 Return <code>{a0, a1 - a0, a2 - a1,...}</code>.
+<p>
+If <code>_lag</code> is <code>k</code> then return <code>a[t] - a[t - k]</code> and leave
+the first <code>k</code> elements unchanged. If <code>_order</code> is greater than 1
+then differences are taken that many times.
+If <code>_mode</code> is 1 return <code>a[t]/a[t - k] - 1</code> and if <code>_mode</code> is 2 return
+<code>log(a[t]/a[t - k])</code>. The first <code>k</code> returns are NaN.
+<p>
+If <code>array</code> has more than one row and column then each column is differenced.
 )xyzyx")
 );
-_FP12* WINAPI xll_array_diff(_FP12* pa)
+_FP12* WINAPI xll_array_diff(_FP12* pa, LONG lag, LONG order, LONG mode)
 {
 #pragma XLLEXPORT
-	FPX* _a = ptr(pa);
+	try {
+		FPX* _a = ptr(pa);
+		if (_a) {
+			pa = _a->get();
+		}
 
-	if (_a) {
-		pa = _a->get();
+		ensure((0 <= mode && mode <= 2) || !"ARRAY.DIFF: _mode must be 0, 1, or 2");
+		ensure((lag >= 0 && order >= 0) || !"ARRAY.DIFF: _lag and _order must be non-negative");
+
+		size_t w = (pa->rows > 1 && pa->columns > 1) ? pa->columns : 1;
+		size_t n = size(*pa) / w;
+
+		for (LONG i = 0; i < (order ? order : 1); ++i) {
+			fms::diff(static_cast<fms::diff_mode>(mode), pa->array, n, w, lag ? lag : 1);
+		}
 	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
 
-	std::adjacent_difference(begin(*pa), end(*pa), begin(*pa));
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
 
 	return pa;
 }
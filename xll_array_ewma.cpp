@@ -0,0 +1,99 @@
+// xll_array_ewma.cpp - Exponentially weighted moving statistics
+#include "fms_ewma.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_ewma(
+	Function(XLL_FP, "xll_array_ewma", "ARRAY.EWMA")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_DOUBLE, "lambda", "is the decay factor between 0 and 1."),
+		Arg(XLL_LONG, "_stat", "is an optional statistic to return. Default is 0."),
+		})
+	.FunctionHelp("Return exponentially weighted moving statistics of the columns of array.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Rows of <code>array</code> are times and columns are series.
+If <code>_stat</code> is 0 return the moving average of each column
+\(m_t = \lambda m_{t-1} + (1 - \lambda) x_t\), \(m_0 = x_0\).
+If <code>_stat</code> is 1 return the moving variance of each column
+\(v_t = \lambda (v_{t-1} + (1 - \lambda) d_t^2)\), \(v_0 = 0\), where \(d_t = x_t - m_{t-1}\).
+If <code>_stat</code> is 2 return the covariance matrix of the columns at the last time
+using the same weights.
+<p>
+The average is a scan over affine maps \(m \mapsto a m + b\) that is computed in parallel blocks of rows.
+<p>
+If <code>array</code> is a handle the in-memory array is not modified.
+)xyzyx")
+);
+_FP12* WINAPI xll_array_ewma(const _FP12* pa, double lambda, LONG stat)
+{
+#pragma XLLEXPORT
+	static FPX y;
+
+	try {
+		ensure((0 <= lambda && lambda <= 1) || !"ARRAY.EWMA: lambda must be between 0 and 1");
+
+		const FPX* _a = ptr(pa);
+		const _FP12* x = _a ? _a->get() : pa;
+		size_t n = x->rows;
+		size_t c = x->columns;
+		if (n == 1) {
+			// a single row is one series
+			n = c;
+			c = 1;
+		}
+
+		switch (stat) {
+		case 0:
+			y.resize(x->rows, x->columns);
+			fms::ewma(n, c, x->array, lambda, y.array());
+			break;
+		case 1:
+			y.resize(x->rows, x->columns);
+			fms::ewma_variance(n, c, x->array, lambda, y.array());
+			break;
+		case 2:
+			y.resize(static_cast<int>(c), static_cast<int>(c));
+			fms::ewma_covariance(n, c, x->array, lambda, y.array());
+			break;
+		default:
+			ensure(!"ARRAY.EWMA: _stat must be 0, 1, or 2");
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return y.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_ewma_test()
+{
+	{
+		FPX a(3, 1);
+		a[0] = 1;
+		a[1] = 2;
+		a[2] = 3;
+		_FP12* pm = xll_array_ewma(a.get(), 0.5, 0);
+		ensure(pm->rows == 3);
+		ensure(pm->array[0] == 1);
+		ensure(pm->array[1] == 1.5);
+		ensure(pm->array[2] == 2.25);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_ewma_test(xll_array_ewma_test);
+
+#endif // _DEBUG
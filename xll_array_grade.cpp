@@ -10,6 +10,7 @@ AddIn xai_array_grade(
 	.Arguments({
 		Arg(XLL_FP, "array", "is an array or handle to an array to grade"),
 		Arg(XLL_LONG, "_count", "is an optional number of elements to partial grade. Default is 0."),
+		Arg(XLL_LONG, "_segment", "is an optional 1 to grade each row or 2 to grade each column. Default is 0."),
 		})
 		.FunctionHelp("Grade _count elements of array in increasing (_count >= 0) or decreasing (n < 0) order.")
 	.Category(CATEGORY)
@@ -22,16 +23,62 @@ the largest <code>-_count</code> values.
 <p>
 Note <code>ARRAY.INDEX(array, ARRAY.GRADE(array))</code> is the same as <code>ARRAY.SORT(array)</code>
 <p>
-<code>array</code> must not be a handle.
+If <code>array</code> is a handle its stable grade, with NaN values last, is cached until
+the in-memory array changes. Later calls to <code>ARRAY.GRADE</code>, <code>ARRAY.SORT</code>,
+<code>ARRAY.RANK</code> and <code>ARRAY.QUANTILE</code> on the same handle reuse it.
+<p>
+If <code>_segment</code> is 1 then return the column indices that stably sort each row
+and if it is 2 return the row indices that stably sort each column, with NaN values last.
+Only the sign of <code>_count</code> is used to pick increasing or decreasing order.
 )xyzyx")
 );
-_FP12* WINAPI xll_array_grade(_FP12* pa, LONG n)
+_FP12* WINAPI xll_array_grade(const _FP12* pa, LONG n, LONG segment)
 {
 #pragma XLLEXPORT
 
 	static FPX a;
 
 	try {
+		ensure((0 <= segment && segment <= 2) || !"ARRAY.GRADE: _segment must be 0, 1, or 2");
+
+		const FPX* _a = ptr(pa);
+		if (segment) {
+			if (_a) {
+				pa = _a->get();
+			}
+			auto r = static_cast<size_t>(pa->rows);
+			auto c = static_cast<size_t>(pa->columns);
+			a.resize(pa->rows, pa->columns);
+			if (segment == 1) {
+				fms::grade_rows(r, c, pa->array, a.array(), n < 0);
+			}
+			else {
+				fms::grade_columns(r, c, pa->array, a.array(), n < 0);
+			}
+
+			return a.get();
+		}
+		if (_a) {
+			auto p = permutation(pa->array[0], _a);
+			LONG na = (LONG)p->size();
+			n = std::clamp(n, -na, na);
+
+			if (n >= 0) {
+				a.resize(n ? n : na, 1);
+				std::copy(p->array(), p->array() + a.size(), begin(a));
+			}
+			else {
+				// decreasing with NaN last
+				size_t m = fms::graded_count(na, _a->array(), p->array());
+				a.resize(n == -1 ? na : -n, 1);
+				for (int i = 0; i < a.size(); ++i) {
+					a[i] = i < (int)m ? (*p)[(int)m - 1 - i] : (*p)[i];
+				}
+			}
+
+			return a.get();
+		}
+
 		LONG na = (LONG)size(*pa);
 		n = std::clamp(n, -na, na);
 
@@ -0,0 +1,122 @@
+// xll_array_groupby.cpp - Aggregate array values by key
+#include <cmath>
+#include "fms_groupby.h"
+#include "fms_monoid.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_groupby(
+	Function(XLL_FP, "xll_array_groupby", "ARRAY.GROUPBY")
+	.Arguments({
+		Arg(XLL_FP, "keys", "is an array or handle to an array of keys."),
+		Arg(XLL_FP, "values", "is an array or handle to an array of values."),
+		Arg(XLL_HANDLEX, "_monoid", "is an optional handle to a monoid. Default is MONOID.ADD()."),
+		})
+	.FunctionHelp("Aggregate rows of values having the same key.")
+	.Category(CATEGORY)
+	.Documentation(R"(
+Aggregate the rows of <code>values</code> having the same key using <code>_monoid</code>.
+The number of rows of <code>values</code> must equal the size of <code>keys</code>.
+Return an array with distinct keys in increasing order in the first column
+and the aggregate of each column of <code>values</code> in the remaining columns.
+NaN keys are ignored. If every key is NaN the result is a single NaN.
+<p>
+Keys with few distinct values are aggregated in parallel hash tables that are
+merged at the end, otherwise keys are sorted and equal runs are aggregated.
+)")
+.SeeAlso({ "MONOID.ADD", "MONOID.MUL", "MONOID.MAX", "MONOID.MIN" })
+);
+_FP12* WINAPI xll_array_groupby(const _FP12* pk, const _FP12* pv, HANDLEX m)
+{
+#pragma XLLEXPORT
+	static FPX a;
+
+	try {
+		const FPX* _k = ptr(pk);
+		if (_k) {
+			pk = _k->get();
+		}
+		const FPX* _v = ptr(pv);
+		if (_v) {
+			pv = _v->get();
+		}
+
+		const fms::monoid<double>* m_ = &fms::monoid_add<double>;
+		if (m) {
+			m_ = safe_pointer<const fms::monoid<double>>(m);
+			ensure(m_ || !"ARRAY.GROUPBY: _monoid must be a handle to a monoid");
+		}
+
+		size_t n = size(*pk);
+		size_t c = pv->columns;
+		if (pv->rows == 1 && pv->columns > 1) {
+			c = 1; // row of values
+		}
+		ensure(static_cast<size_t>(size(*pv)) == n * c || !"ARRAY.GROUPBY: rows of values must equal size of keys");
+
+		std::vector<double> keys, aggs;
+		fms::visit(*m_, [&](double id, auto op) {
+			fms::groupby(n, pk->array, c, pv->array, id, op, keys, aggs);
+
+			return 0;
+		});
+
+		if (keys.empty()) {
+			// Excel arrays cannot be empty
+			a.resize(1, 1);
+			a[0] = NAN;
+
+			return a.get();
+		}
+
+		a.resize(static_cast<int>(keys.size()), static_cast<int>(1 + c));
+		for (size_t g = 0; g < keys.size(); ++g) {
+			a(static_cast<int>(g), 0) = keys[g];
+			for (size_t j = 0; j < c; ++j) {
+				a(static_cast<int>(g), static_cast<int>(1 + j)) = aggs[g * c + j];
+			}
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return a.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_groupby_test()
+{
+	{
+		FPX k(4, 1), v(4, 1);
+		k[0] = 2; k[1] = 1; k[2] = 2; k[3] = 1;
+		v[0] = 1; v[1] = 2; v[2] = 3; v[3] = 4;
+
+		_FP12* pa = xll_array_groupby(k.get(), v.get(), 0);
+		ensure(pa->rows == 2);
+		ensure(pa->columns == 2);
+		ensure(pa->array[0] == 1);
+		ensure(pa->array[1] == 6);
+		ensure(pa->array[2] == 2);
+		ensure(pa->array[3] == 4);
+
+		k[0] = k[1] = k[2] = k[3] = NAN;
+		pa = xll_array_groupby(k.get(), v.get(), 0);
+		ensure(pa->rows == 1 && pa->columns == 1);
+		ensure(std::isnan(pa->array[0]));
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_groupby_test(xll_array_groupby_test);
+
+#endif // _DEBUG
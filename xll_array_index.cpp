@@ -1,4 +1,6 @@
 // xll_array_index.cpp - Project rows/columns
+#include <cmath>
+#include <limits>
 #include "xll_array.h"
 
 using namespace xll;
@@ -16,8 +18,21 @@ AddIn xai_array_index(
 This works like <code>INDEX</code> for arrays except indices are cyclic.
 If <code>rows</code> or <code>columns</code> are missing then all
 rows or columns are returned.
+Indices that are not numbers are an error.
+If <code>array</code> is a handle to a virtual sequence then only the
+selected items are computed.
 )")
 );
+// integer value of the index o[i]
+static long long array_index(const OPER& o, unsigned i)
+{
+	ensure(isNum(o[i]) || !"ARRAY.INDEX: indices must be numbers");
+	double x = o[i].val.num;
+	ensure(std::fabs(x) < 0x1p63 || !"ARRAY.INDEX: index out of range");
+
+	return static_cast<long long>(x);
+}
+
 _FP12* WINAPI xll_array_index(_FP12* pa, LPOPER pr, LPOPER pc)
 {
 #pragma XLLEXPORT
@@ -27,6 +42,34 @@ _FP12* WINAPI xll_array_index(_FP12* pa, LPOPER pr, LPOPER pc)
 		unsigned r = size(*pr);
 		unsigned c = size(*pc);
 
+		const fms::sequence* _s = seq(pa);
+		if (_s) {
+			// one column so every column index is 0
+			if (isMissing(*pr)) {
+				ensure(_s->count <= static_cast<size_t>(std::numeric_limits<int>::max()) || !"ARRAY.INDEX: too many items");
+				r = static_cast<unsigned>(_s->count);
+			}
+			if (isMissing(*pc)) {
+				c = 1;
+			}
+			else {
+				for (unsigned j = 0; j < c; ++j) {
+					array_index(*pc, j);
+				}
+			}
+			a.resize(r, c);
+			const long long n = static_cast<long long>(_s->count);
+			for (unsigned i = 0; i < r; ++i) {
+				long long ri = isMissing(*pr) ? i : array_index(*pr, i);
+				double ai = (*_s)[static_cast<size_t>((ri % n + n) % n)];
+				for (unsigned j = 0; j < c; ++j) {
+					a(i, j) = ai;
+				}
+			}
+
+			return a.get();
+		}
+
 		if (size(*pa) == 1) {
 			handle<FPX> h_(pa->array[0]);
 			if (h_) {
@@ -44,9 +87,9 @@ _FP12* WINAPI xll_array_index(_FP12* pa, LPOPER pr, LPOPER pc)
 		a.resize(r, c);
 
 		for (unsigned i = 0; i < r; ++i) {
-			unsigned ri = isMissing(*pr) ? i : static_cast<unsigned>((*pr)[i].val.num);
+			unsigned ri = isMissing(*pr) ? i : static_cast<unsigned>(array_index(*pr, i));
 			for (unsigned j = 0; j < c; ++j) {
-				unsigned cj = isMissing(*pc) ? j : static_cast<unsigned>((*pc)[j].val.num);
+				unsigned cj = isMissing(*pc) ? j : static_cast<unsigned>(array_index(*pc, j));
 				a(i, j) = index(*pa, ri, cj);
 			}
 		}
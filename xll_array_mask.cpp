@@ -1,4 +1,6 @@
 // xll_array_mask.cpp - Mask array elements
+#include <cmath>
+#include "fms_compact.h"
 #include "xll_array.h"
 
 using namespace xll;
@@ -15,34 +17,121 @@ AddIn xai_array_mask(
 If <code>mask</code> is smaller than <code>array</code> then it is
 applied using cyclic indices. If <code>array</code> has more than one
 row then the mask is applied to rows.
+<p>
+If <code>array</code> is a handle the in-memory array is compacted in place
+and its handle is returned. If <code>array</code> is a handle to a virtual
+sequence then only the kept items are computed and returned as a column.
+If no items are kept the result is a single NaN.
 )")
 );
 _FP12* WINAPI xll_array_mask(_FP12* pa, const _FP12* pm)
 {
 #pragma XLLEXPORT
-	static FPX a;
-
 	try {
-		a = *pa;
 		FPX* _a = ptr(pa);
 		const FPX* _m = ptr(pm);
 		if (_m) {
 			pm = _m->get();
 		}
 
+		const fms::sequence* _s = seq(pa);
+		if (_s) {
+			static FPX a;
+			size_t n = fms::mask_count(*_s, pm->array, size(*pm));
+			if (n == 0) {
+				a.resize(1, 1);
+				a[0] = NAN;
+
+				return a.get();
+			}
+			a.resize(static_cast<int>(n), 1);
+			fms::mask(*_s, pm->array, size(*pm), a.array());
+
+			return a.get();
+		}
+
+		_FP12* pa_ = _a ? _a->get() : pa;
+		// rows of a two dimensional array, otherwise elements
+		size_t w = (pa_->rows > 1 && pa_->columns > 1) ? pa_->columns : 1;
+		size_t n = fms::compact(pa_->array, size(*pa_) / w, w, pm->array, size(*pm));
+
+		int r = pa_->rows;
+		int c = pa_->columns;
+		if (n == 0) {
+			// Excel arrays cannot be empty
+			r = c = 1;
+			pa_->array[0] = NAN;
+		}
+		else if (w > 1 || c == 1) {
+			r = static_cast<int>(n);
+		}
+		else {
+			c = static_cast<int>(n);
+		}
+
 		if (_a) {
-			mask(_a->get(), pm);
+			_a->resize(r, c);
 		}
 		else {
-			mask(a.get(), pm);
+			pa->rows = r;
+			pa->columns = c;
 		}
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
+
+		return nullptr;
 	}
 	catch (...) {
-		XLL_ERROR("ARRAY.TAKE: unknown exception");
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
 	}
 
-	return a.get();
+	return pa;
 }
+
+#ifdef _DEBUG
+
+_FP12* WINAPI xll_array_sequence(double start, double stop, double incr);
+HANDLEX WINAPI xll_array_sequence_(double start, double stop, double incr);
+
+int xll_array_mask_test()
+{
+	{
+		FPX a = *xll_array_sequence(1, 5, 1);
+		FPX m(1, 2);
+		m[0] = 0;
+		m[1] = 1;
+		_FP12* pa = xll_array_mask(a.get(), m.get());
+		ensure(pa->rows == 2);
+		ensure(pa->columns == 1);
+		ensure(pa->array[0] == 2);
+		ensure(pa->array[1] == 4);
+	}
+	{
+		FPX s(1, 1);
+		s[0] = xll_array_sequence_(1, 5, 1);
+		FPX m(1, 2);
+		m[0] = 0;
+		m[1] = 1;
+		_FP12* pa = xll_array_mask(s.get(), m.get());
+		ensure(pa->rows == 2);
+		ensure(pa->array[0] == 2);
+		ensure(pa->array[1] == 4);
+	}
+	{
+		FPX a = *xll_array_sequence(1, 5, 1);
+		FPX m(1, 1);
+		m[0] = 0;
+		_FP12* pa = xll_array_mask(a.get(), m.get());
+		ensure(pa->rows == 1);
+		ensure(pa->columns == 1);
+		ensure(std::isnan(pa->array[0]));
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_mask_test(xll_array_mask_test);
+
+#endif // _DEBUG
@@ -0,0 +1,56 @@
+// xll_array_memo.cpp - Memoization cache statistics
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_memo(
+	Function(XLL_FP, "xll_array_memo", "ARRAY.MEMO")
+	.Arguments({
+		Arg(XLL_DOUBLE, "_budget", "is an optional number of bytes the cache may use."),
+		Arg(XLL_BOOL, "_clear", "is an optional flag to clear the cache. Default is false."),
+		})
+	.FunctionHelp("Return hit and miss counters of the memoization cache.")
+	.Category(CATEGORY)
+	.Volatile()
+	.Documentation(R"xyzyx(
+Return a row of the number of cache hits, misses, cached results, and bytes used.
+<p>
+<code>ARRAY.ACF</code> and <code>ARRAY.GRADE</code> of a handle cache their result and
+<code>ARRAY.SORT</code> and <code>ARRAY.UNIQUE</code> of a handle remember the array is done.
+Every function that can modify an in-memory array gives it a new version so
+cached results are only used while the array is unchanged.
+The least recently used results are dropped when the cache uses more than <code>_budget</code> bytes.
+)xyzyx")
+);
+_FP12* WINAPI xll_array_memo(double budget, BOOL clear)
+{
+#pragma XLLEXPORT
+	static FPX a(1, 4);
+
+	try {
+		if (budget > 0) {
+			memo().budget(static_cast<size_t>(budget));
+		}
+		if (clear) {
+			memo().clear();
+		}
+
+		auto s = memo().stats();
+		a[0] = static_cast<double>(s.hits);
+		a[1] = static_cast<double>(s.misses);
+		a[2] = static_cast<double>(s.entries);
+		a[3] = static_cast<double>(s.bytes);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return a.get();
+}
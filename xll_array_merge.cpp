@@ -0,0 +1,74 @@
+// xll_array_merge.cpp - Merge sorted arrays
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "fms_merge.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_merge(
+	Function(XLL_FP, "xll_array_merge", "ARRAY.MERGE")
+	.Arguments({
+		Arg(XLL_FP, "handles", "is an array of handles to increasing arrays."),
+		Arg(XLL_BOOL, "_unique", "is an optional boolean indicating duplicates are dropped. Default is FALSE."),
+		})
+	.FunctionHelp("Return a column of the merged items of sorted handles.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Merge the in-memory arrays of <code>handles</code> into one increasing column
+in a single pass instead of joining and sorting them. Each array must be increasing.
+Equal items keep the order of <code>handles</code>. If <code>_unique</code> is
+true then only the first of equal items is kept.
+If every array is empty the result is a single NaN.
+<p>
+A loser tree finds the next item in \(\log_2 k\) comparisons for \(k\) handles
+and large merges are split into parts that are merged in parallel.
+)xyzyx")
+.SeeAlso({ "ARRAY.JOIN", "ARRAY.SORT", "ARRAY.UNIQUE" })
+);
+_FP12* WINAPI xll_array_merge(const _FP12* ph, BOOL unique)
+{
+#pragma XLLEXPORT
+	static FPX a;
+
+	try {
+		size_t k = size(*ph);
+		std::vector<const double*> x(k);
+		std::vector<size_t> n(k);
+		size_t N = 0;
+
+		for (size_t i = 0; i < k; ++i) {
+			handle<FPX> h_(ph->array[i]);
+			ensure(h_ || !"ARRAY.MERGE: handles must be handles to arrays");
+			x[i] = h_->array();
+			n[i] = h_->size();
+			ensure(std::is_sorted(x[i], x[i] + n[i]) || !"ARRAY.MERGE: arrays must be increasing");
+			N += n[i];
+		}
+
+		if (N == 0) {
+			// Excel arrays cannot be empty
+			a.resize(1, 1);
+			a[0] = NAN;
+
+			return a.get();
+		}
+
+		a.resize(static_cast<int>(N), 1);
+		size_t m = fms::merge(k, x.data(), n.data(), a.array(), unique);
+		a.resize(static_cast<int>(m), 1);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return a.get();
+}
@@ -0,0 +1,126 @@
+// xll_array_mmult.cpp - Matrix multiplication
+#include "fms_gemm.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_mmult(
+	Function(XLL_FP, "xll_array_mmult", "ARRAY.MMULT")
+	.Arguments({
+		Arg(XLL_FP, "a", "is an array or handle to an array."),
+		Arg(XLL_FP, "b", "is an array or handle to an array."),
+		})
+	.FunctionHelp("Return the matrix product of a and b.")
+	.Category(CATEGORY)
+	.Documentation(R"(
+Return the matrix product of <code>a</code> and <code>b</code>. The number of columns
+of <code>a</code> must equal the number of rows of <code>b</code>.
+This uses a cache blocked multithreaded kernel, or BLAS if the add-in is built with <code>FMS_BLAS</code> defined.
+<p>
+Either argument may be a handle. The in-memory arrays are not modified.
+)")
+.SeeAlso({ "ARRAY.GEMV" })
+);
+_FP12* WINAPI xll_array_mmult(const _FP12* pa, const _FP12* pb)
+{
+#pragma XLLEXPORT
+	static FPX c;
+
+	try {
+		const FPX* _a = ptr(pa);
+		const FPX* _b = ptr(pb);
+		const _FP12* a = _a ? _a->get() : pa;
+		const _FP12* b = _b ? _b->get() : pb;
+
+		ensure(a->columns == b->rows || !"ARRAY.MMULT: columns of a must equal rows of b");
+
+		c.resize(a->rows, b->columns);
+		fms::gemm(a->rows, b->columns, a->columns, a->array, b->array, c.array());
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return c.get();
+}
+
+AddIn xai_array_gemv(
+	Function(XLL_FP, "xll_array_gemv", "ARRAY.GEMV")
+	.Arguments({
+		Arg(XLL_FP, "a", "is an array or handle to an array."),
+		Arg(XLL_FP, "x", "is a vector or handle to a vector."),
+		})
+	.FunctionHelp("Return the product of matrix a and vector x.")
+	.Category(CATEGORY)
+	.Documentation(R"(
+Return the one column array <code>a x</code>. The size of <code>x</code>
+must equal the number of columns of <code>a</code>.
+<p>
+Either argument may be a handle. The in-memory arrays are not modified.
+)")
+.SeeAlso({ "ARRAY.MMULT" })
+);
+_FP12* WINAPI xll_array_gemv(const _FP12* pa, const _FP12* px)
+{
+#pragma XLLEXPORT
+	static FPX y;
+
+	try {
+		const FPX* _a = ptr(pa);
+		const FPX* _x = ptr(px);
+		const _FP12* a = _a ? _a->get() : pa;
+		const _FP12* x = _x ? _x->get() : px;
+
+		ensure(a->columns == size(*x) || !"ARRAY.GEMV: columns of a must equal size of x");
+
+		y.resize(a->rows, 1);
+		fms::gemv(a->rows, a->columns, a->array, x->array, y.array());
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return y.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_mmult_test()
+{
+	{
+		FPX a(2, 2), b(2, 1);
+		a[0] = 1; a[1] = 2;
+		a[2] = 3; a[3] = 4;
+		b[0] = 1; b[1] = 1;
+
+		_FP12* pc = xll_array_mmult(a.get(), b.get());
+		ensure(pc->rows == 2);
+		ensure(pc->columns == 1);
+		ensure(pc->array[0] == 3);
+		ensure(pc->array[1] == 7);
+
+		_FP12* py = xll_array_gemv(a.get(), b.get());
+		ensure(py->rows == 2);
+		ensure(py->array[0] == 3);
+		ensure(py->array[1] == 7);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_mmult_test(xll_array_mmult_test);
+
+#endif // _DEBUG
@@ -0,0 +1,163 @@
+// xll_array_permute.cpp - Apply and invert permutations.
+#include <bit>
+#include <cstdint>
+#include "fms_permute.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_permute(
+	Function(XLL_FP, "xll_array_permute", "ARRAY.PERMUTE")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_FP, "permutation", "is a permutation of the rows or elements of array."),
+		})
+	.FunctionHelp("Permute the rows or elements of array in place.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Replace item <code>i</code> of <code>array</code> by item <code>permutation[i]</code>.
+If <code>array</code> has more than one row and <code>permutation</code> has one index
+per row then rows are permuted, otherwise elements are.
+Indices start at 0 so <code>ARRAY.PERMUTE(array, ARRAY.GRADE(array))</code>
+is the same as <code>ARRAY.SORT(array)</code>.
+<p>
+If <code>array</code> is a handle the in-memory array is permuted in place and the
+handle is returned. Recalculating with the same permutation does not permute it again
+unless the in-memory array has changed. Small arrays and arrays too large to buffer are permuted
+by following cycles of the permutation, otherwise blocks are gathered in parallel.
+)xyzyx")
+.SeeAlso({ "ARRAY.INVERSE.PERMUTATION", "ARRAY.GRADE", "ARRAY.INDEX" })
+);
+_FP12* WINAPI xll_array_permute(_FP12* pa, const _FP12* pp)
+{
+#pragma XLLEXPORT
+	try {
+		size_t n = size(*pp);
+		ensure(fms::is_permutation(n, pp->array) || !"ARRAY.PERMUTE: permutation must contain each index once");
+
+		std::string key;
+		if (const FPX* a_ = ptr(static_cast<const _FP12*>(pa))) {
+			// FNV-1a hash of the permutation
+			uint64_t h = 14695981039346656037ULL;
+			for (size_t i = 0; i < n; ++i) {
+				h = (h ^ static_cast<uint64_t>(pp->array[i])) * 1099511628211ULL;
+			}
+			key = fms::memo_key("ARRAY.PERMUTE", { pa->array[0], static_cast<double>(n), std::bit_cast<double>(h) });
+			if (unchanged(key, a_)) {
+				return pa; // already permuted
+			}
+		}
+
+		FPX* _a = ptr(pa);
+		_FP12* x = _a ? _a->get() : pa;
+
+		if (x->rows > 1 && n == static_cast<size_t>(x->rows)) {
+			fms::permute(x->array, n, x->columns, pp->array);
+		}
+		else {
+			ensure(n == static_cast<size_t>(size(*x)) || !"ARRAY.PERMUTE: permutation must have one index per row or element");
+			fms::permute(x->array, n, 1, pp->array);
+		}
+
+		if (_a) {
+			record(key, _a);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return pa;
+}
+
+AddIn xai_array_inverse_permutation(
+	Function(XLL_FP, "xll_array_inverse_permutation", "ARRAY.INVERSE.PERMUTATION")
+	.Arguments({
+		Arg(XLL_FP, "permutation", "is a permutation of 0, 1, ..."),
+		})
+	.FunctionHelp("Return the inverse of permutation.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return the permutation <code>q</code> with <code>q[p[i]] = i</code> having the same shape as
+<code>p</code>. The inverse of a grade gives the position of each item in the sorted array.
+)xyzyx")
+.SeeAlso({ "ARRAY.PERMUTE", "ARRAY.GRADE", "ARRAY.RANK" })
+);
+_FP12* WINAPI xll_array_inverse_permutation(const _FP12* pp)
+{
+#pragma XLLEXPORT
+	static FPX q;
+
+	try {
+		size_t n = size(*pp);
+		ensure(fms::is_permutation(n, pp->array) || !"ARRAY.INVERSE.PERMUTATION: permutation must contain each index once");
+
+		q.resize(pp->rows, pp->columns);
+		fms::inverse_permutation(n, pp->array, q.array());
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return q.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_permute_test()
+{
+	{
+		FPX a(3, 2);
+		for (int i = 0; i < a.size(); ++i) {
+			a[i] = i;
+		}
+		FPX p(1, 3);
+		p[0] = 2;
+		p[1] = 0;
+		p[2] = 1;
+		_FP12* pa = xll_array_permute(a.get(), p.get());
+		ensure(pa->array[0] == 4);
+		ensure(pa->array[1] == 5);
+		ensure(pa->array[2] == 0);
+
+		_FP12* pq = xll_array_inverse_permutation(p.get());
+		ensure(pq->columns == 3);
+		ensure(pq->array[0] == 1);
+		ensure(pq->array[1] == 2);
+		ensure(pq->array[2] == 0);
+
+		pa = xll_array_permute(a.get(), pq);
+		for (int i = 0; i < a.size(); ++i) {
+			ensure(a[i] == i);
+		}
+
+		// recalculating a handle does not permute it again
+		handle<FPX> a_(new FPX(a));
+		touch(a_.ptr());
+		FPX h(1, 1);
+		h[0] = a_.get();
+		xll_array_permute(h.get(), p.get());
+		xll_array_permute(h.get(), p.get());
+		ensure((*a_)[0] == 4);
+		ensure((*a_)[2] == 0);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_permute_test(xll_array_permute_test);
+
+#endif // _DEBUG
@@ -0,0 +1,58 @@
+// xll_array_pool.cpp - Pool allocator statistics
+#include "fms_pool.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_pool(
+	Function(XLL_FP, "xll_array_pool", "ARRAY.POOL")
+	.Arguments({
+		Arg(XLL_BOOL, "_trim", "is an optional flag to release cached memory. Default is false."),
+		})
+	.FunctionHelp("Return allocation counters of the scratch buffer pool.")
+	.Category(CATEGORY)
+	.Volatile()
+	.Documentation(R"xyzyx(
+Return a row of the number of allocations, deallocations, allocations
+reusing freed storage, bytes in use, and bytes cached for reuse.
+If <code>_trim</code> is true then cached chunks are released first.
+<p>
+Scratch buffers of <code>ARRAY.DIFF</code>, <code>ARRAY.REDUCE</code>, <code>ARRAY.COV</code>,
+and <code>ARRAY.CONVOLVE</code> are allocated from a pool.
+Arrays returned by functions and arrays held by handles are not,
+so the counters do not include them.
+Small allocations come from slabs of power of 2 size classes and large
+allocations are huge page aligned chunks that are cached for reuse when freed.
+)xyzyx")
+);
+_FP12* WINAPI xll_array_pool(BOOL trim)
+{
+#pragma XLLEXPORT
+	static FPX a(1, 5);
+
+	try {
+		fms::pool& p = fms::pool::instance();
+		if (trim) {
+			p.trim();
+		}
+
+		auto s = p.stats();
+		a[0] = static_cast<double>(s.allocations);
+		a[1] = static_cast<double>(s.deallocations);
+		a[2] = static_cast<double>(s.reuses);
+		a[3] = static_cast<double>(s.bytes);
+		a[4] = static_cast<double>(s.cached);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return a.get();
+}
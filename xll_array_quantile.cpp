@@ -0,0 +1,189 @@
+// xll_array_quantile.cpp - Quantiles and histograms of arrays.
+#include <cmath>
+#include <vector>
+#include "fms_quantile.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_quantile(
+	Function(XLL_FP, "xll_array_quantile", "ARRAY.QUANTILE")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_FP, "p", "is an array of probabilities."),
+		})
+	.FunctionHelp("Return quantiles of array at probabilities p.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return the quantiles of <code>array</code> having the same shape as <code>p</code>.
+This uses the same interpolation as <code>PERCENTILE.INC</code>. 
+Only the order statistics needed are selected so this is
+\(O(n\log q)\) instead of \(O(n\log n)\) for sorting where \(q\) is the size of <code>p</code>.
+NaN values are ignored and a NaN probability has a NaN quantile.
+<p>
+If <code>array</code> is a handle the in-memory array is not modified.
+When its grade is cached by <code>ARRAY.GRADE</code> or <code>ARRAY.RANK</code>
+each quantile is \(O(1)\).
+)xyzyx")
+.SeeAlso({ "ARRAY.SORT", "ARRAY.GRADE", "ARRAY.HISTOGRAM" })
+);
+_FP12* WINAPI xll_array_quantile(_FP12* pa, _FP12* pp)
+{
+#pragma XLLEXPORT
+	static FPX q;
+
+	try {
+		q.resize(pp->rows, pp->columns);
+
+		const FPX* _a = ptr(static_cast<const _FP12*>(pa));
+		if (_a) {
+			if (auto g = permutation(pa->array[0], _a, false)) {
+				fms::graded_quantile(_a->size(), _a->array(), g->array(), pp->array, size(*pp), q.array());
+
+				return q.get();
+			}
+			std::vector<double> a(_a->array(), _a->array() + _a->size());
+			fms::quantile(a.data(), a.size(), pp->array, size(*pp), q.array());
+		}
+		else {
+			// pa is ours to reorder
+			fms::quantile(pa->array, size(*pa), pp->array, size(*pp), q.array());
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return q.get();
+}
+
+AddIn xai_array_histogram(
+	Function(XLL_FP, "xll_array_histogram", "ARRAY.HISTOGRAM")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_FP, "edges", "is an increasing array of bin edges or the number of bins."),
+		})
+	.FunctionHelp("Return the number of array elements in each bin.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return a one column array of counts of elements of <code>array</code>
+in the bins <code>[edges[i], edges[i + 1])</code>. The last bin includes its right endpoint.
+Elements outside of the bins and NaN are not counted.
+If <code>edges</code> is a number <code>n</code> then use
+<code>n</code> bins of equal width from the minimum to the maximum of <code>array</code>.
+<p>
+Blocks of the array are counted in parallel and merged at the end.
+)xyzyx")
+.SeeAlso({ "ARRAY.QUANTILE" })
+);
+_FP12* WINAPI xll_array_histogram(const _FP12* pa, const _FP12* pe)
+{
+#pragma XLLEXPORT
+	static FPX c;
+
+	try {
+		const FPX* _a = ptr(pa);
+		if (_a) {
+			pa = _a->get();
+		}
+
+		size_t n = size(*pa);
+		if (size(*pe) == 1) {
+			double e0 = pe->array[0];
+			ensure((e0 >= 1 && e0 == std::floor(e0)) || !"ARRAY.HISTOGRAM: number of bins must be a positive integer");
+			size_t nb = static_cast<size_t>(e0);
+
+			// NaN values are not counted
+			double lo = INFINITY, hi = -INFINITY;
+			for (size_t i = 0; i < n; ++i) {
+				double x = pa->array[i];
+				if (!std::isnan(x)) {
+					lo = std::min(lo, x);
+					hi = std::max(hi, x);
+				}
+			}
+			ensure(lo <= hi || !"ARRAY.HISTOGRAM: array must have a number");
+
+			c.resize(static_cast<int>(nb), 1);
+			fms::histogram(pa->array, n, lo, hi, nb, c.array());
+		}
+		else {
+			size_t ne = size(*pe);
+			ensure(std::is_sorted(pe->array, pe->array + ne) || !"ARRAY.HISTOGRAM: edges must be increasing");
+
+			c.resize(static_cast<int>(ne - 1), 1);
+			fms::histogram(pa->array, n, pe->array, ne, c.array());
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return c.get();
+}
+
+#ifdef _DEBUG
+
+_FP12* WINAPI xll_array_sequence(double start, double stop, double incr);
+
+int xll_array_quantile_test()
+{
+	{
+		FPX a = *xll_array_sequence(1, 5, 1);
+		FPX p(1, 2);
+		p[0] = 0.5;
+		p[1] = 1;
+		_FP12* pq = xll_array_quantile(a.get(), p.get());
+		ensure(pq->rows == 1);
+		ensure(pq->columns == 2);
+		ensure(pq->array[0] == 3);
+		ensure(pq->array[1] == 5);
+	}
+	{
+		// the cached grade of a handle is used and not invalidated
+		handle<FPX> a_(new FPX(*xll_array_sequence(1, 5, 1)));
+		FPX h(1, 1);
+		h[0] = a_.get();
+		ensure(permutation(h[0], a_.ptr()) != nullptr);
+		auto s = memo().stats();
+		FPX p(1, 1);
+		p[0] = 0.5;
+		_FP12* pq = xll_array_quantile(h.get(), p.get());
+		ensure(pq->array[0] == 3);
+		ensure(memo().stats().hits == s.hits + 1);
+		ensure(permutation(h[0], a_.ptr(), false) != nullptr);
+	}
+	{
+		FPX a = *xll_array_sequence(1, 5, 1);
+		FPX e(1, 1);
+		e[0] = 2;
+		_FP12* pc = xll_array_histogram(a.get(), e.get());
+		ensure(pc->rows == 2);
+		ensure(pc->array[0] == 2);
+		ensure(pc->array[1] == 3);
+
+		a[0] = NAN;
+		pc = xll_array_histogram(a.get(), e.get());
+		ensure(pc->array[0] == 2);
+		ensure(pc->array[1] == 2);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_quantile_test(xll_array_quantile_test);
+
+#endif // _DEBUG
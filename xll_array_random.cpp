@@ -0,0 +1,116 @@
+// xll_array_random.cpp - Reproducible random arrays
+#include <cmath>
+#include <cstdint>
+#include "fms_random.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+static const char xll_array_random_doc[] = R"xyzyx(
+Fill an array with <code>rows</code> times <code>columns</code> random variates.
+If <code>_distribution</code> is 0 they are uniform on (0, 1), if 1 they are standard normal,
+and if 2 they are exponential with mean 1.
+<p>
+Values are generated by the Philox counter-based generator so they depend
+only on <code>_seed</code>, truncated to an integer, and their position in the array. The same seed
+gives the same array no matter how many threads generate it.
+)xyzyx";
+
+static void xll_array_random_fill(FPX& a, LONG r, LONG c, LONG d, double seed)
+{
+	ensure((r >= 0 && c >= 0) || !"ARRAY.RANDOM: rows and columns must be non-negative");
+	ensure((0 <= d && d <= 2) || !"ARRAY.RANDOM: _distribution must be 0, 1, or 2");
+	ensure(std::fabs(seed) < 0x1p63 || !"ARRAY.RANDOM: _seed must be a finite integer");
+	// negative seeds are two's complement
+	const uint64_t s = static_cast<uint64_t>(static_cast<int64_t>(seed));
+
+	a.resize(r ? r : 1, c ? c : 1);
+	fms::random(a.array(), size(*a.get()), static_cast<fms::random_distribution>(d), s);
+}
+
+AddIn xai_array_random_(
+	Function(XLL_HANDLEX, "xll_array_random_", "\\ARRAY.RANDOM")
+	.Arguments({
+		Arg(XLL_LONG, "rows", "is the number of rows."),
+		Arg(XLL_LONG, "columns", "is the number of columns."),
+		Arg(XLL_LONG, "_distribution", "is an optional distribution. Default is 0 for uniform."),
+		Arg(XLL_DOUBLE, "_seed", "is an optional seed. Default is 0."),
+		})
+	.Uncalced()
+	.FunctionHelp("Return a handle to an in-memory array of random numbers.")
+	.Category(CATEGORY)
+	.Documentation(xll_array_random_doc)
+	.SeeAlso({ "ARRAY.RANDOM", "\\ARRAY" })
+);
+HANDLEX WINAPI xll_array_random_(LONG r, LONG c, LONG d, double seed)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		handle<FPX> h_(new FPX());
+		xll_array_random_fill(*h_, r, c, d, seed);
+		touch(h_.ptr());
+		h = h_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return h;
+}
+
+AddIn xai_array_random(
+	Function(XLL_FP, "xll_array_random", "ARRAY.RANDOM")
+	.Arguments({
+		Arg(XLL_LONG, "rows", "is the number of rows."),
+		Arg(XLL_LONG, "columns", "is the number of columns."),
+		Arg(XLL_LONG, "_distribution", "is an optional distribution. Default is 0 for uniform."),
+		Arg(XLL_DOUBLE, "_seed", "is an optional seed. Default is 0."),
+		})
+	.FunctionHelp("Return an array of random numbers.")
+	.Category(CATEGORY)
+	.Documentation(xll_array_random_doc)
+	.SeeAlso({ "\\ARRAY.RANDOM" })
+);
+_FP12* WINAPI xll_array_random(LONG r, LONG c, LONG d, double seed)
+{
+#pragma XLLEXPORT
+	static FPX a;
+
+	try {
+		xll_array_random_fill(a, r, c, d, seed);
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return a.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_random_test()
+{
+	{
+		FPX a(*xll_array_random(3, 2, 1, 42));
+		_FP12* pb = xll_array_random(3, 2, 1, 42);
+		ensure(pb->rows == 3 && pb->columns == 2);
+		ensure(std::equal(begin(a), end(a), begin(*pb)));
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_random_test(xll_array_random_test);
+
+#endif // _DEBUG
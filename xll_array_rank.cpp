@@ -0,0 +1,143 @@
+// xll_array_rank.cpp - Rank of array elements or values.
+#include <cmath>
+#include <vector>
+#include "fms_grade.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_rank(
+	Function(XLL_FP, "xll_array_rank", "ARRAY.RANK")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_LONG, "_method", "is an optional tie method: 0 min, 1 average, 2 max, 3 dense, 4 ordinal. Default is 0."),
+		Arg(XLL_LPOPER, "_values", "is an optional array of values to rank."),
+		})
+	.FunctionHelp("Return the increasing rank of each element of array or of values in array.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return the rank of each element of <code>array</code> in increasing order starting at 1.
+NaN has rank NaN. Ties are ranked by <code>_method</code>
+<dl>
+<dt>0</dt><dd>the lowest rank of the group like <code>RANK.EQ</code></dd>
+<dt>1</dt><dd>the average rank of the group like <code>RANK.AVG</code></dd>
+<dt>2</dt><dd>the highest rank of the group</dd>
+<dt>3</dt><dd>one plus the number of distinct smaller values</dd>
+<dt>4</dt><dd>the position in the stable sort order</dd>
+</dl>
+If <code>array</code> has more than one row and column then each column is ranked
+independently and columns are ranked in parallel.
+<p>
+If <code>_values</code> is not missing return one plus the number of elements of
+<code>array</code> less than each value with the same shape as <code>_values</code>.
+Values that are not numbers have rank NaN.
+<p>
+If <code>array</code> is a handle its grade and ranks are cached until the in-memory array
+changes so ranking values is \(O(\log n)\) per value.
+)xyzyx")
+.SeeAlso({ "ARRAY.GRADE", "ARRAY.SORT", "ARRAY.QUANTILE" })
+);
+_FP12* WINAPI xll_array_rank(const _FP12* pa, LONG method, LPOPER pv)
+{
+#pragma XLLEXPORT
+	static FPX r;
+
+	try {
+		ensure((0 <= method && method <= 4) || !"ARRAY.RANK: _method must be 0, 1, 2, 3, or 4");
+
+		std::shared_ptr<const FPX> g;
+		std::vector<double> g_;
+		std::string key;
+
+		HANDLEX h = pa->array[0];
+		const FPX* _a = ptr(pa);
+		if (_a) {
+			pa = _a->get();
+		}
+		bool by_column = pa->rows > 1 && pa->columns > 1;
+
+		// grade of the flattened array, cached for handles
+		auto grade = [&]() -> const double* {
+			if (_a) {
+				g = permutation(h, _a);
+
+				return g->array();
+			}
+			g_.resize(size(*pa));
+			fms::grade(g_.size(), pa->array, g_.data());
+
+			return g_.data();
+		};
+
+		if (isMissing(*pv)) {
+			if (_a) {
+				key = fms::memo_key("ARRAY.RANK", { h, static_cast<double>(version(_a)), static_cast<double>(method) });
+				if (auto m = memo().find(key)) {
+					r = *m;
+
+					return r.get();
+				}
+			}
+
+			auto rank_method = static_cast<fms::rank_method>(method);
+			r.resize(pa->rows, pa->columns);
+			if (by_column) {
+				fms::rank_columns(pa->rows, pa->columns, pa->array, r.array(), rank_method);
+			}
+			else {
+				fms::rank(size(*pa), pa->array, grade(), r.array(), rank_method);
+			}
+
+			if (_a) {
+				memo().insert(key, std::make_shared<const FPX>(r), r.size() * sizeof(double));
+			}
+		}
+		else {
+			const double* p = grade();
+			size_t n = size(*pa);
+			r.resize(rows(*pv), columns(*pv));
+			for (int i = 0; i < r.size(); ++i) {
+				r[i] = isNum((*pv)[i]) ? fms::rank(n, pa->array, p, (*pv)[i].val.num) : NAN;
+			}
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return r.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_rank_test()
+{
+	{
+		FPX a(1, 4);
+		a[0] = 3;
+		a[1] = 1;
+		a[2] = 2;
+		a[3] = 1;
+		OPER v(1.5);
+		_FP12* pr = xll_array_rank(a.get(), 0, &v);
+		ensure(pr->rows == 1);
+		ensure(pr->columns == 1);
+		ensure(pr->array[0] == 3);
+
+		OPER s("a");
+		pr = xll_array_rank(a.get(), 0, &s);
+		ensure(std::isnan(pr->array[0]));
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_rank_test(xll_array_rank_test);
+
+#endif // _DEBUG
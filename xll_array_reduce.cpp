@@ -0,0 +1,100 @@
+// xll_array_reduce.cpp - Reduce rows or columns of an array with a monoid
+#include "fms_monoid.h"
+#include "fms_reduce.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+AddIn xai_array_reduce(
+	Function(XLL_FP, "xll_array_reduce", "ARRAY.REDUCE")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_HANDLEX, "_monoid", "is an optional handle to a monoid. Default is MONOID.ADD()."),
+		Arg(XLL_LONG, "_axis", "is an optional axis to reduce over. Default is 0."),
+		})
+	.FunctionHelp("Reduce the columns or rows of array using a monoid.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+If <code>_axis</code> is 0 return a row containing the reduction of each column of <code>array</code>.
+If <code>_axis</code> is 1 return a column containing the reduction of each row.
+Items are combined in order so <code>_monoid</code> need not be commutative.
+<p>
+Rows are folded contiguously and columns are accumulated a row at a time
+so the inner loop runs over adjacent memory. Blocks of rows are reduced in parallel.
+<p>
+If <code>array</code> is a handle the in-memory array is not modified.
+)xyzyx")
+.SeeAlso({ "MONOID.ADD", "MONOID.MUL", "MONOID.MAX", "MONOID.MIN" })
+);
+_FP12* WINAPI xll_array_reduce(const _FP12* pa, HANDLEX m, LONG axis)
+{
+#pragma XLLEXPORT
+	static FPX y;
+
+	try {
+		ensure((axis == 0 || axis == 1) || !"ARRAY.REDUCE: _axis must be 0 or 1");
+
+		const fms::monoid<double>* m_ = &fms::monoid_add<double>;
+		if (m) {
+			m_ = safe_pointer<const fms::monoid<double>>(m);
+			ensure(m_ || !"ARRAY.REDUCE: _monoid must be a handle to a monoid");
+		}
+
+		const FPX* _a = ptr(pa);
+		const _FP12* x = _a ? _a->get() : pa;
+		size_t r = x->rows;
+		size_t c = x->columns;
+
+		if (axis == 0) {
+			y.resize(1, x->columns);
+		}
+		else {
+			y.resize(x->rows, 1);
+		}
+		fms::visit(*m_, [&](double id, auto op) {
+			if (axis == 0) {
+				fms::reduce_columns(r, c, x->array, id, op, y.array());
+			}
+			else {
+				fms::reduce_rows(r, c, x->array, id, op, y.array());
+			}
+
+			return 0;
+		});
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return y.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_reduce_test()
+{
+	{
+		FPX a(2, 3);
+		for (int i = 0; i < a.size(); ++i) {
+			a[i] = i + 1;
+		}
+		_FP12* py = xll_array_reduce(a.get(), 0, 0);
+		ensure(py->rows == 1 && py->columns == 3);
+		ensure(py->array[0] == 5 && py->array[1] == 7 && py->array[2] == 9);
+		py = xll_array_reduce(a.get(), 0, 1);
+		ensure(py->rows == 2 && py->columns == 1);
+		ensure(py->array[0] == 6 && py->array[1] == 15);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_reduce_test(xll_array_reduce_test);
+
+#endif // _DEBUG
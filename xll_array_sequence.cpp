@@ -1,4 +1,5 @@
 // xll_array_sequence.cpp - Arithmetic sequence.
+#include <limits>
 #include "xll_array.h"
 
 using namespace xll;
@@ -17,6 +18,7 @@ Return a one columns array <code>{start; start + incr; ...; stop}<code>.
 If <code>_incr</code> is greater than 1 return <code>_incr</code> values
 from <code>start</code> to <code>stop</code>
 )")
+.SeeAlso({ "\\ARRAY.SEQUENCE" })
 );
 _FP12* WINAPI xll_array_sequence(double start, double stop, double incr)
 {
@@ -24,26 +26,11 @@ _FP12* WINAPI xll_array_sequence(double start, double stop, double incr)
 	static xll::FPX a;
 
 	try {
-		if (incr == 0) {
-			incr = 1;
-			if (start > stop) {
-				incr = -1;
-			}
-		}
-
-		unsigned n;
-		if (incr > 1) {
-			n = static_cast<unsigned>(incr);
-			incr = (stop - start) / (n - 1);
-		}
-		else {
-			n = 1u + static_cast<unsigned>(fabs((stop - start) / incr));
-		}
-
-		a.resize(n, 1);
-		for (unsigned i = 0; i < n; ++i) {
-			a[i] = start + i * incr;
-		}
+		auto s = fms::make_sequence(start, stop, incr);
+		ensure(s.count <= static_cast<size_t>(std::numeric_limits<int>::max()) || !"ARRAY.SEQUENCE: too many items");
+
+		a.resize(static_cast<int>(s.count), 1);
+		fms::materialize(s, a.array(), s.count);
 	}
 	catch (const std::exception& ex) {
 		XLL_ERROR(ex.what());
@@ -55,3 +42,40 @@ _FP12* WINAPI xll_array_sequence(double start, double stop, double incr)
 	return a.get();
 }
 
+AddIn xai_array_sequence_(
+	Function(XLL_HANDLEX, "xll_array_sequence_", "\\ARRAY.SEQUENCE")
+	.Arguments({
+		Arg(XLL_DOUBLE, "start", "is the first value in the sequence.", "0"),
+		Arg(XLL_DOUBLE, "stop", "is the last value in the sequence.", "3"),
+		Arg(XLL_DOUBLE, "_incr", "is an optional value to increment by. Default is 1.")
+		})
+	.Uncalced()
+	.FunctionHelp("Return a handle to a virtual one column array from start to stop.")
+	.Category(CATEGORY)
+	.Documentation(R"(
+Return a handle to the sequence <code>ARRAY.SEQUENCE(start, stop, _incr)</code>
+that stores only its start, increment, and count.
+<code>ARRAY.INDEX</code>, <code>ARRAY.MASK</code>, <code>ARRAY.APPLY</code>, <code>ARRAY.ROWS</code>,
+<code>ARRAY.COLUMNS</code>, and <code>ARRAY.SIZE</code> compute items as needed
+and <code>ARRAY(handle)</code> returns the materialized array.
+)")
+.SeeAlso({ "ARRAY.SEQUENCE", "ARRAY" })
+);
+HANDLEX WINAPI xll_array_sequence_(double start, double stop, double incr)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		handle<fms::sequence> h_(new fms::sequence(fms::make_sequence(start, stop, incr)));
+		h = h_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return h;
+}
@@ -0,0 +1,235 @@
+// xll_array_sketch.cpp - Streaming quantile sketches
+#include <bit>
+#include <cstdint>
+#include <set>
+#include <string>
+#include "fms_sketch.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+// Sketch with a version changed by every update and the keys of the inputs
+// already added so recalculating ARRAY.SKETCH.ADD or ARRAY.SKETCH.MERGE is idempotent.
+struct sketch : fms::kll {
+	uint64_t version = 0;
+	std::set<std::string> added;
+
+	using fms::kll::kll;
+
+	// true the first time key is seen
+	bool once(const std::string& key)
+	{
+		return added.insert(key).second;
+	}
+};
+
+AddIn xai_array_sketch_(
+	Function(XLL_HANDLEX, "xll_array_sketch_", "\\ARRAY.SKETCH")
+	.Arguments({
+		Arg(XLL_LONG, "_k", "is an optional accuracy parameter. Default is 200."),
+		})
+	.Uncalced()
+	.FunctionHelp("Return a handle to an empty quantile sketch.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Create a KLL quantile sketch. Values are added using <code>ARRAY.SKETCH.ADD</code>
+and approximate quantiles are returned by <code>ARRAY.SKETCH.QUANTILE</code>.
+The rank error is about <code>1.7/_k</code> and memory is proportional to <code>_k</code>
+no matter how many values are added.
+)xyzyx")
+.SeeAlso({ "ARRAY.SKETCH.ADD", "ARRAY.SKETCH.MERGE", "ARRAY.SKETCH.QUANTILE" })
+);
+HANDLEX WINAPI xll_array_sketch_(LONG k)
+{
+#pragma XLLEXPORT
+	HANDLEX h = INVALID_HANDLEX;
+
+	try {
+		handle<sketch> h_(new sketch(k > 0 ? k : 200));
+		h = h_.get();
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+	}
+
+	return h;
+}
+
+AddIn xai_array_sketch_add(
+	Function(XLL_HANDLEX, "xll_array_sketch_add", "ARRAY.SKETCH.ADD")
+	.Arguments({
+		Arg(XLL_HANDLEX, "sketch", "is a handle to a sketch."),
+		Arg(XLL_FP, "array", "is an array or handle to an array of values to add."),
+		})
+	.FunctionHelp("Add array values to a sketch and return its handle.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Add the values of <code>array</code> to <code>sketch</code>. NaN values are ignored.
+Large arrays are sketched in parallel blocks that are merged.
+<p>
+The sketch is modified in place. Values already added are not added again when
+the calling cell is recalculated. An <code>array</code> handle is identified by its
+handle and version and other arrays by their values, so adding equal values
+from another cell is also skipped.
+)xyzyx")
+);
+HANDLEX WINAPI xll_array_sketch_add(HANDLEX h, const _FP12* pa)
+{
+#pragma XLLEXPORT
+	try {
+		handle<sketch> h_(h);
+		ensure(h_ || !"ARRAY.SKETCH.ADD: not a handle to a sketch");
+
+		std::string key;
+		const FPX* _a = ptr(pa);
+		if (_a) {
+			key = fms::memo_key("ARRAY.SKETCH.ADD", { pa->array[0], static_cast<double>(version(_a)) });
+			pa = _a->get();
+		}
+		else {
+			// FNV-1a hash of the values
+			uint64_t x = 14695981039346656037ULL;
+			for (int i = 0; i < size(*pa); ++i) {
+				x = (x ^ std::bit_cast<uint64_t>(pa->array[i])) * 1099511628211ULL;
+			}
+			key = fms::memo_key("ARRAY.SKETCH.ADD", { static_cast<double>(size(*pa)), std::bit_cast<double>(x) });
+		}
+
+		if (h_->once(key)) {
+			h_->merge(fms::sketch(pa->array, size(*pa), h_->parameter()));
+			++h_->version;
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return INVALID_HANDLEX;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return INVALID_HANDLEX;
+	}
+
+	return h;
+}
+
+AddIn xai_array_sketch_merge(
+	Function(XLL_HANDLEX, "xll_array_sketch_merge", "ARRAY.SKETCH.MERGE")
+	.Arguments({
+		Arg(XLL_HANDLEX, "sketch", "is a handle to a sketch."),
+		Arg(XLL_HANDLEX, "other", "is a handle to a sketch to merge."),
+		})
+	.FunctionHelp("Merge other into sketch and return its handle.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Merge the values summarized by <code>other</code> into <code>sketch</code>.
+This is the monoid operation for sketches so chunks can be summarized
+independently and combined.
+<p>
+The sketch is modified in place. A version of <code>other</code> already merged
+is not merged again when the calling cell is recalculated.
+Merging a sketch with itself doubles the weight of its values once.
+)xyzyx")
+);
+HANDLEX WINAPI xll_array_sketch_merge(HANDLEX h, HANDLEX o)
+{
+#pragma XLLEXPORT
+	try {
+		handle<sketch> h_(h);
+		ensure(h_ || !"ARRAY.SKETCH.MERGE: not a handle to a sketch");
+		handle<sketch> o_(o);
+		ensure(o_ || !"ARRAY.SKETCH.MERGE: other is not a handle to a sketch");
+
+		auto key = [&]() {
+			return fms::memo_key("ARRAY.SKETCH.MERGE", { o, static_cast<double>(o_->version) });
+		};
+		if (h_->once(key())) {
+			h_->merge(*o_);
+			++h_->version;
+			if (h == o) {
+				h_->once(key()); // a recalculation sees the merged version
+			}
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return INVALID_HANDLEX;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return INVALID_HANDLEX;
+	}
+
+	return h;
+}
+
+AddIn xai_array_sketch_quantile(
+	Function(XLL_FP, "xll_array_sketch_quantile", "ARRAY.SKETCH.QUANTILE")
+	.Arguments({
+		Arg(XLL_HANDLEX, "sketch", "is a handle to a sketch."),
+		Arg(XLL_FP, "p", "is an array of probabilities."),
+		})
+	.FunctionHelp("Return approximate quantiles of the values added to sketch.")
+	.Category(CATEGORY)
+	.Documentation(R"xyzyx(
+Return approximate quantiles having the same shape as <code>p</code>.
+A NaN probability has a NaN quantile.
+)xyzyx")
+.SeeAlso({ "ARRAY.QUANTILE" })
+);
+_FP12* WINAPI xll_array_sketch_quantile(HANDLEX h, _FP12* pp)
+{
+#pragma XLLEXPORT
+	try {
+		handle<sketch> h_(h);
+		ensure(h_ || !"ARRAY.SKETCH.QUANTILE: not a handle to a sketch");
+
+		for (int i = 0; i < size(*pp); ++i) {
+			pp->array[i] = h_->quantile(pp->array[i]);
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return pp;
+}
+
+#ifdef _DEBUG
+
+int xll_array_sketch_test()
+{
+	{
+		HANDLEX h = xll_array_sketch_(0);
+		FPX a(1, 3);
+		a[0] = 1;
+		a[1] = 2;
+		a[2] = 3;
+		xll_array_sketch_add(h, a.get());
+		xll_array_sketch_add(h, a.get());
+		handle<sketch> h_(h);
+		ensure(h_->size() == 3);
+
+		xll_array_sketch_merge(h, h);
+		xll_array_sketch_merge(h, h);
+		ensure(h_->size() == 6);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_sketch_test(xll_array_sketch_test);
+
+#endif // _DEBUG
@@ -1,5 +1,7 @@
 // xll_array_sort.cpp - Sort or partial sort arrays.
 #include <algorithm>
+#include <vector>
+#include "fms_sort.h"
 #include "xll_array.h"
 
 using namespace xll;
@@ -9,6 +11,7 @@ AddIn xai_array_sort(
 	.Arguments({
 		Arg(XLL_FP, "array", "is an array or handle to an array to sort"),
 		Arg(XLL_LONG, "_count", "is an optional number of elements to partial sort. Default is 0."),
+		Arg(XLL_LONG, "_segment", "is an optional 1 to sort each row or 2 to sort each column. Default is 0."),
 		})
 	.FunctionHelp("Sort _count elements of array in increasing (_count >= 0) or decreasing (n < 0) order.")
 	.Category(CATEGORY)
@@ -23,33 +26,92 @@ the last row are set to \(\infty\) or \(-\infty\) if the sort is
 increasing or decreasing, respecively.
 <p>
 If <code>array</code> is a handle return a handle to the sorted array.
+Sorting a handle again is skipped if the in-memory array has not changed.
+If the grade of the handle is cached by <code>ARRAY.GRADE</code> or <code>ARRAY.RANK</code>
+a full increasing sort gathers from it instead of sorting.
+<p>
+Full sorts of nearly sorted or reversed arrays, such as a sorted handle
+with a few items appended or changed, use an adaptive merge sort
+that is close to linear time.
+<p>
+If <code>_segment</code> is 1 then each row is sorted independently and if it is 2
+each column is. Only the sign of <code>_count</code> is used to pick increasing or
+decreasing order. Short segments are sorted by a sorting network and
+segments are sorted in parallel.
 )xyzyx")
 );
-_FP12* WINAPI xll_array_sort(_FP12* pa, LONG n)
+_FP12* WINAPI xll_array_sort(_FP12* pa, LONG n, LONG segment)
 {
 #pragma XLLEXPORT
+	try {
+		ensure((0 <= segment && segment <= 2) || !"ARRAY.SORT: _segment must be 0, 1, or 2");
 
-	FPX* _a = ptr(pa);
-	if (_a) {
-		pa = _a->get();
-	}
+		const FPX* a_ = ptr(static_cast<const _FP12*>(pa));
+		std::string key;
+		std::shared_ptr<const FPX> p;
+		if (a_) {
+			key = fms::memo_key("ARRAY.SORT", { pa->array[0], static_cast<double>(n), static_cast<double>(segment) });
+			if (unchanged(key, a_)) {
+				return const_cast<FPX*>(a_)->get(); // already sorted
+			}
+			if (n == 0 && segment == 0) {
+				p = permutation(pa->array[0], a_, false);
+			}
+		}
 
-	LONG na = (LONG)size(*pa);
-	n = std::clamp(n, -na, na);
+		FPX* _a = ptr(pa);
+		if (_a) {
+			pa = _a->get();
+		}
 
-	if (n == 0) {
-		n = na;
-		std::sort(begin(*pa), end(*pa));
-	}
-	else if (n > 0) {
-		std::partial_sort(begin(*pa), begin(*pa) + n, end(*pa));
+		LONG na = (LONG)size(*pa);
+		n = std::clamp(n, -na, na);
+
+		if (segment == 1 || segment == 2) {
+			auto r = static_cast<size_t>(pa->rows);
+			auto c = static_cast<size_t>(pa->columns);
+			if (segment == 1) {
+				n < 0 ? fms::sort_rows(r, c, pa->array, std::greater<double>{}) : fms::sort_rows(r, c, pa->array);
+			}
+			else {
+				n < 0 ? fms::sort_columns(r, c, pa->array, std::greater<double>{}) : fms::sort_columns(r, c, pa->array);
+			}
+		}
+		else if (p) {
+			// gather using the cached grade
+			std::vector<double> a(begin(*pa), end(*pa));
+			for (LONG i = 0; i < na; ++i) {
+				pa->array[i] = a[(size_t)(*p)[i]];
+			}
+		}
+		else if (n == 0) {
+			n = na;
+			fms::sort(pa->array, na);
+		}
+		else if (n > 0) {
+			std::partial_sort(begin(*pa), begin(*pa) + n, end(*pa));
+		}
+		else if (n == -1) {
+			n = na;
+			fms::sort(pa->array, na, std::greater<double>{});
+		}
+		else { // n < -1
+			std::partial_sort(begin(*pa), begin(*pa) - n, end(*pa), std::greater<double>{});
+		}
+
+		if (_a) {
+			record(key, _a);
+		}
 	}
-	else if (n == -1) {
-		n = na;
-		std::sort(begin(*pa), end(*pa), std::greater<double>{});
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
 	}
-	else { // n < -1
-		std::partial_sort(begin(*pa), begin(*pa) - n, end(*pa), std::greater<double>{});
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
 	}
 
 	return pa;
@@ -0,0 +1,90 @@
+// xll_array_transpose.cpp - Transpose arrays
+#include <vector>
+#include "fms_transpose.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+// Largest handle transposed using a temporary copy. Larger arrays are transposed in place.
+static const size_t transpose_copy_max = 1 << 24;
+
+AddIn xai_array_transpose(
+	Function(XLL_FP, "xll_array_transpose", "ARRAY.TRANSPOSE")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		})
+	.FunctionHelp("Return the transpose of array.")
+	.Category(CATEGORY)
+	.Documentation(R"(
+Return the transpose of <code>array</code> using a cache blocked algorithm.
+<p>
+If <code>array</code> is a handle the in-memory array is transposed and its
+handle is returned. Square arrays are transposed in place. Arrays with more than
+2<sup>24</sup> elements are transposed in place by following permutation cycles
+using one bit per element of extra memory.
+)")
+.SeeAlso({ "ARRAY.RESIZE" })
+);
+_FP12* WINAPI xll_array_transpose(_FP12* pa)
+{
+#pragma XLLEXPORT
+	static FPX a;
+
+	try {
+		FPX* _a = ptr(pa);
+		if (_a) {
+			size_t r = _a->rows();
+			size_t c = _a->columns();
+
+			if (r == c || r * c > transpose_copy_max) {
+				fms::transpose(r, c, _a->array());
+			}
+			else {
+				std::vector<double> b(_a->array(), _a->array() + r * c);
+				fms::transpose(r, c, b.data(), _a->array());
+			}
+			_a->resize(static_cast<int>(c), static_cast<int>(r));
+
+			return pa;
+		}
+
+		a.resize(pa->columns, pa->rows);
+		fms::transpose(pa->rows, pa->columns, pa->array, a.array());
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return a.get();
+}
+
+#ifdef _DEBUG
+
+int xll_array_transpose_test()
+{
+	{
+		FPX a(2, 3);
+		for (int i = 0; i < a.size(); ++i) {
+			a[i] = i;
+		}
+		_FP12* pb = xll_array_transpose(a.get());
+		ensure(pb->rows == 3);
+		ensure(pb->columns == 2);
+		ensure(pb->array[0] == 0);
+		ensure(pb->array[1] == 3);
+		ensure(pb->array[2] == 1);
+		ensure(pb->array[5] == 5);
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_transpose_test(xll_array_transpose_test);
+
+#endif // _DEBUG
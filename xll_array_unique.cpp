@@ -16,12 +16,23 @@ This function calls the STL function
 <a href="https://en.cppreference.com/w/cpp/algorithm/unique"<code>std::unique</code></a>
 on <code>array</code>. Just like <code>std::unique</code>, the array must be sorted
 to guarantee all duplicate entries are removed.
+If <code>array</code> is a handle that has not changed since the last call
+the in-memory array is returned without scanning it again.
 )xyzyx")
 .SeeAlso({ "ARRAY.SORT" })
 );
 _FP12* WINAPI xll_array_unique(_FP12* pa)
 {
 #pragma XLLEXPORT
+	const FPX* a_ = ptr(static_cast<const _FP12*>(pa));
+	std::string key;
+	if (a_) {
+		key = fms::memo_key("ARRAY.UNIQUE", { pa->array[0] });
+		if (unchanged(key, a_)) {
+			return const_cast<FPX*>(a_)->get(); // already unique
+		}
+	}
+
 	FPX* _a = ptr(pa);
 	if (_a) {
 		pa = _a->get();
@@ -38,5 +49,9 @@ _FP12* WINAPI xll_array_unique(_FP12* pa)
 		pa->rows = n;
 	}
 
+	if (_a) {
+		record(key, _a);
+	}
+
 	return pa;
 }
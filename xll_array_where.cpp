@@ -0,0 +1,162 @@
+// xll_array_where.cpp - Evaluate a predicate on array elements
+#include <cmath>
+#include "fms_compact.h"
+#include "fms_op.h"
+#include "xll_array.h"
+
+using namespace xll;
+
+// m[i] = p(x[i], y[i % ny]) ? 1 : 0
+template<class P>
+inline void where(const double* x, size_t n, const double* y, size_t ny, P p, double* m)
+{
+	const size_t b = fms::compact_block;
+
+	fms::parallel_for((n + b - 1) / b, [=](size_t k) {
+		const size_t e = std::min(n, (k + 1) * b);
+		if (ny == 1) {
+			const double y0 = y[0];
+			for (size_t i = k * b; i < e; ++i) {
+				m[i] = p(x[i], y0) ? 1. : 0.;
+			}
+		}
+		else {
+			for (size_t i = k * b; i < e; ++i) {
+				m[i] = p(x[i], y[i % ny]) ? 1. : 0.;
+			}
+		}
+	});
+}
+
+AddIn xai_array_where(
+	Function(XLL_FP, "xll_array_where", "ARRAY.WHERE")
+	.Arguments({
+		Arg(XLL_FP, "array", "is an array or handle to an array."),
+		Arg(XLL_HANDLEX, "op", "is a handle to a binary operator."),
+		Arg(XLL_FP, "value", "is a value, array, or handle to an array."),
+		Arg(XLL_BOOL, "_compact", "is an optional flag to return the elements satisfying the predicate. Default is FALSE."),
+		})
+	.FunctionHelp("Return a mask of op(array, value) or the array elements where it is true.")
+	.Category(CATEGORY)
+	.Documentation(R"(
+Return an array of 1 where <code>op(array[i], value[i])</code> is true and 0 otherwise.
+If <code>value</code> is smaller than <code>array</code> then it is
+applied using cyclic indices.
+Comparison operators are <code>LT</code>, <code>LE</code>, <code>GT</code>,
+<code>GE</code>, <code>EQ</code>, and <code>NE</code>. Masks can be combined
+using <code>LOGICAL.AND</code> and <code>LOGICAL.OR</code>, e.g.,
+<code>ARRAY.WHERE(ARRAY.WHERE(array, GE(), 0), LOGICAL.AND(), ARRAY.WHERE(array, LT(), 1))</code>.
+<p>
+If <code>_compact</code> is true then return the elements of <code>array</code>
+where the predicate is true. This is the same as <code>ARRAY.MASK(array, ARRAY.WHERE(array, op, value))</code>
+but no intermediate mask is created.
+<p>
+If <code>array</code> is a handle the mask is returned and the in-memory array is not modified.
+If <code>_compact</code> is true the in-memory array is compacted and its handle is returned.
+If no elements satisfy the predicate the compacted result is a single NaN.
+)")
+.SeeAlso({ "ARRAY.MASK" })
+);
+_FP12* WINAPI xll_array_where(_FP12* pa, HANDLEX op, const _FP12* pv, BOOL compact)
+{
+#pragma XLLEXPORT
+	static FPX m;
+
+	try {
+		const FPX* _v = ptr(pv);
+		if (_v) {
+			pv = _v->get();
+		}
+		const fms::binop<double>* op_ = to_pointer<const fms::binop<double>>(op);
+		ensure(op_ || !"ARRAY.WHERE: op must be a handle to a binary operator");
+
+		size_t nv = size(*pv);
+
+		if (compact) {
+			FPX* _a = ptr(pa);
+			_FP12* pa_ = _a ? _a->get() : pa;
+			size_t n = size(*pa_);
+			size_t k = fms::visit(*op_, [=](auto p) {
+				return fms::compact_if(pa_->array, n, pv->array, nv, p);
+			});
+
+			int r = pa_->rows == 1 ? 1 : static_cast<int>(k);
+			int c = pa_->rows == 1 ? static_cast<int>(k) : 1;
+			if (k == 0) {
+				// Excel arrays cannot be empty
+				r = c = 1;
+				pa_->array[0] = NAN;
+			}
+			if (_a) {
+				_a->resize(r, c);
+			}
+			else {
+				pa->rows = r;
+				pa->columns = c;
+			}
+		}
+		else {
+			const FPX* _a = ptr(static_cast<const _FP12*>(pa));
+			const _FP12* pa_ = _a ? _a->get() : pa;
+			m.resize(pa_->rows, pa_->columns);
+			fms::visit(*op_, [=](auto p) {
+				where(pa_->array, size(*pa_), pv->array, nv, p, m.array());
+
+				return 0;
+			});
+
+			return m.get();
+		}
+	}
+	catch (const std::exception& ex) {
+		XLL_ERROR(ex.what());
+
+		return nullptr;
+	}
+	catch (...) {
+		XLL_ERROR(__FUNCTION__ ": unknown exception");
+
+		return nullptr;
+	}
+
+	return pa;
+}
+
+#ifdef _DEBUG
+
+_FP12* WINAPI xll_array_sequence(double start, double stop, double incr);
+
+int xll_array_where_test()
+{
+	{
+		FPX a = *xll_array_sequence(1, 5, 1);
+		FPX v(1, 1);
+		v[0] = 3;
+		HANDLEX gt = to_handle<const fms::binop<double>>(&fms::binop_gt<double>);
+
+		_FP12* pm = xll_array_where(a.get(), gt, v.get(), FALSE);
+		ensure(size(*pm) == 5);
+		ensure(pm->array[0] == 0 && pm->array[2] == 0 && pm->array[3] == 1 && pm->array[4] == 1);
+		ensure(a[3] == 4); // array is not modified
+
+		_FP12* pa = xll_array_where(a.get(), gt, v.get(), TRUE);
+		ensure(pa->rows == 2);
+		ensure(pa->array[0] == 4);
+		ensure(pa->array[1] == 5);
+	}
+	{
+		FPX a = *xll_array_sequence(1, 5, 1);
+		FPX v(1, 1);
+		v[0] = 9;
+		HANDLEX gt = to_handle<const fms::binop<double>>(&fms::binop_gt<double>);
+
+		_FP12* pa = xll_array_where(a.get(), gt, v.get(), TRUE);
+		ensure(pa->rows == 1 && pa->columns == 1);
+		ensure(std::isnan(pa->array[0]));
+	}
+
+	return TRUE;
+}
+Auto<OpenAfter> xaoa_array_where_test(xll_array_where_test);
+
+#endif // _DEBUG
@@ -1,6 +1,6 @@
 // xll_monoid.cpp
 #include "fms_monoid.h"
-#include "xll/xll/xll.h"
+#include "xll24/include/xll.h"
 
 #ifndef CATEGORY
 #define CATEGORY "Monoid"
@@ -20,6 +20,42 @@ HANDLEX WINAPI xll_monoid_add()
 	return safe_handle<const fms::monoid<double>>(&fms::monoid_add<double>);
 }
 
+AddIn xai_monoid_mul(
+	Function(XLL_HANDLEX, "xll_monoid_mul", "MONOID.MUL")
+	.Arguments({})
+	.Category(CATEGORY)
+	.FunctionHelp("Return handle to multiplication monoid.")
+);
+HANDLEX WINAPI xll_monoid_mul()
+{
+#pragma XLLEXPORT
+	return safe_handle<const fms::monoid<double>>(&fms::monoid_mul<double>);
+}
+
+AddIn xai_monoid_max(
+	Function(XLL_HANDLEX, "xll_monoid_max", "MONOID.MAX")
+	.Arguments({})
+	.Category(CATEGORY)
+	.FunctionHelp("Return handle to maximum monoid.")
+);
+HANDLEX WINAPI xll_monoid_max()
+{
+#pragma XLLEXPORT
+	return safe_handle<const fms::monoid<double>>(&fms::monoid_max<double>);
+}
+
+AddIn xai_monoid_min(
+	Function(XLL_HANDLEX, "xll_monoid_min", "MONOID.MIN")
+	.Arguments({})
+	.Category(CATEGORY)
+	.FunctionHelp("Return handle to minimum monoid.")
+);
+HANDLEX WINAPI xll_monoid_min()
+{
+#pragma XLLEXPORT
+	return safe_handle<const fms::monoid<double>>(&fms::monoid_min<double>);
+}
+
 AddIn xai_monoid_op(
 	Function(XLL_DOUBLE, "xll_monoid_op", "MONOID")
 	.Arguments({
@@ -21,4 +21,158 @@ HANDLEX WINAPI xll_add()
 	static HANDLEX handle_add = to_handle<const binop<double>>(&binop_add<double>);
 
 	return handle_add;
-}
\ No newline at end of file
+}
+
+AddIn xai_sub(
+	Function(XLL_HANDLEX, "xll_sub", "SUB")
+	.Arguments({})
+	.FunctionHelp("Binary subtraction.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_sub()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_sub = to_handle<const binop<double>>(&binop_sub<double>);
+
+	return handle_sub;
+}
+
+AddIn xai_mul(
+	Function(XLL_HANDLEX, "xll_mul", "MUL")
+	.Arguments({})
+	.FunctionHelp("Binary multiplication.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_mul()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_mul = to_handle<const binop<double>>(&binop_mul<double>);
+
+	return handle_mul;
+}
+
+AddIn xai_div(
+	Function(XLL_HANDLEX, "xll_div", "DIV")
+	.Arguments({})
+	.FunctionHelp("Binary division.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_div()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_div = to_handle<const binop<double>>(&binop_div<double>);
+
+	return handle_div;
+}
+
+AddIn xai_lt(
+	Function(XLL_HANDLEX, "xll_lt", "LT")
+	.Arguments({})
+	.FunctionHelp("Binary less than.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_lt()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_lt = to_handle<const binop<double>>(&binop_lt<double>);
+
+	return handle_lt;
+}
+
+AddIn xai_le(
+	Function(XLL_HANDLEX, "xll_le", "LE")
+	.Arguments({})
+	.FunctionHelp("Binary less than or equal.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_le()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_le = to_handle<const binop<double>>(&binop_le<double>);
+
+	return handle_le;
+}
+
+AddIn xai_gt(
+	Function(XLL_HANDLEX, "xll_gt", "GT")
+	.Arguments({})
+	.FunctionHelp("Binary greater than.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_gt()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_gt = to_handle<const binop<double>>(&binop_gt<double>);
+
+	return handle_gt;
+}
+
+AddIn xai_ge(
+	Function(XLL_HANDLEX, "xll_ge", "GE")
+	.Arguments({})
+	.FunctionHelp("Binary greater than or equal.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_ge()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_ge = to_handle<const binop<double>>(&binop_ge<double>);
+
+	return handle_ge;
+}
+
+AddIn xai_eq(
+	Function(XLL_HANDLEX, "xll_eq", "EQ")
+	.Arguments({})
+	.FunctionHelp("Binary equal.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_eq()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_eq = to_handle<const binop<double>>(&binop_eq<double>);
+
+	return handle_eq;
+}
+
+AddIn xai_ne(
+	Function(XLL_HANDLEX, "xll_ne", "NE")
+	.Arguments({})
+	.FunctionHelp("Binary not equal.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_ne()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_ne = to_handle<const binop<double>>(&binop_ne<double>);
+
+	return handle_ne;
+}
+
+AddIn xai_logical_and(
+	Function(XLL_HANDLEX, "xll_logical_and", "LOGICAL.AND")
+	.Arguments({})
+	.FunctionHelp("Binary logical and.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_logical_and()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_logical_and = to_handle<const binop<double>>(&binop_logical_and<double>);
+
+	return handle_logical_and;
+}
+
+AddIn xai_logical_or(
+	Function(XLL_HANDLEX, "xll_logical_or", "LOGICAL.OR")
+	.Arguments({})
+	.FunctionHelp("Binary logical or.")
+	.Category(CATEGORY)
+);
+HANDLEX WINAPI xll_logical_or()
+{
+#pragma XLLEXPORT
+	static HANDLEX handle_logical_or = to_handle<const binop<double>>(&binop_logical_or<double>);
+
+	return handle_logical_or;
+}